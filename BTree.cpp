@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <map>
+#include <limits>
+#include <algorithm>
+
+#include "include/BTree.hpp"
+
+// Random adds and removes checked one by one against std::map, then a range.
+bool testAgainstMap(){
+    BTree<long, long> tree;
+    std::map<long, long> model;
+    std::mt19937_64 rng(1);
+    for(int i=0; i<300000; ++i){
+        const long k=static_cast<long>(rng()%100000);
+        long v;
+        if(rng()%3){
+            if(tree.add(std::pair<long, long>(k, k*2))!=model.emplace(k, k*2).second) return false;
+        }else{
+            const bool removed=tree.remove(k, v);
+            if(removed!=(model.erase(k)>0) || (removed && v!=k*2)) return false;
+        }
+    }
+
+    std::vector<long> got, expected;
+    tree.forRange(1000, 50000, [&got](const long k, const long){ got.push_back(k); });
+    for(auto it=model.lower_bound(1000); it!=model.end() && it->first<=50000; ++it) expected.push_back(it->first);
+    std::cout << "against std::map: " << model.size() << " keys, size " << tree.size() << "\n";
+    return got==expected && tree.size()==model.size();
+}
+
+// Writers add and remove odd keys, each in its own stripe with its own
+// std::map, while readers look up and scan the even keys, which never change.
+// Every reader must see every even key, in order, with its own value; at the
+// end the tree must hold exactly what the writers' maps say.
+bool testConcurrent(){
+    const long keys=20000;
+    const int writers=4, readers=4;
+    BTree<long, long> tree;
+    for(long k=0; k<keys; k+=2) tree.add(std::pair<long, long>(k, k));
+
+    std::vector<std::map<long, long>> models(writers);
+    std::atomic<bool> stop{false};
+    std::atomic<long> bad{0};
+    std::vector<std::thread> workers;
+    for(int w=0; w<writers; ++w){
+        workers.emplace_back([&, w]{
+            std::mt19937_64 rng(w+5);
+            for(int i=0; i<100000; ++i){
+                const long k=static_cast<long>(rng()%(keys/2/writers))*2*writers+2*w+1;
+                long v;
+                if(rng()&1){
+                    if(tree.add(std::pair<long, long>(k, k+w))!=models[w].emplace(k, k+w).second) ++bad;
+                }else{
+                    const bool removed=tree.remove(k, v);
+                    if(removed!=(models[w].erase(k)>0) || (removed && v!=k+w)) ++bad;
+                }
+            }
+        });
+    }
+    for(int r=0; r<readers; ++r){
+        workers.emplace_back([&, r]{
+            std::mt19937_64 rng(r+9);
+            while(!stop){
+                const long k=static_cast<long>(rng()%(keys/2))*2;
+                long v;
+                if(!tree.find(k, v) || v!=k) ++bad;
+                const long hi=std::min(k+200, keys-1);
+                long prev=-1, evens=0;
+                tree.forRange(k, hi, [&](const long kk, const long vv){
+                    if(kk<=prev || kk<k || kk>hi) ++bad;
+                    if(kk%2==0){
+                        if(vv!=kk) ++bad;
+                        ++evens;
+                    }
+                    prev=kk;
+                });
+                if(evens!=(hi-k)/2+1) ++bad;
+            }
+        });
+    }
+    for(int w=0; w<writers; ++w) workers[w].join();
+    stop=true;
+    for(auto& th : workers){
+        if(th.joinable()) th.join();
+    }
+
+    std::map<long, long> expected;
+    for(long k=0; k<keys; k+=2) expected.emplace(k, k);
+    for(auto& m : models) expected.insert(m.begin(), m.end());
+    std::map<long, long> got;
+    tree.forRange(std::numeric_limits<long>::min(), std::numeric_limits<long>::max(),
+                  [&got](const long k, const long v){ got.emplace(k, v); });
+    std::cout << "concurrent: " << writers << " writers, " << readers << " readers, " << bad << " bad reads, "
+              << got.size() << " keys left\n";
+    return !bad && got==expected && tree.size()==expected.size();
+}
+
+int main(){
+    const bool ok=testAgainstMap() && testConcurrent();
+    std::cout << (ok? "ok" : "FAILED") << "\n";
+    return ok? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#ifndef _HARNESS_H_
+#define _HARNESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KeyGenerator.hpp"
+#include "LatencyRecorder.hpp"
+
+struct BenchParams{
+    int threads=1;
+    int readPct=50;
+    KeyDistribution dist=KeyDistribution::Uniform;
+    std::size_t valueSize=8;
+    std::uint64_t keys=10000;
+    double minTime=0.2;
+};
+
+struct BenchResult{
+    std::string name;
+    BenchParams params;
+    std::uint64_t ops=0;
+    double seconds=0;
+    std::uint64_t p50=0, p99=0, p999=0, maxNs=0;
+
+    double opsPerSec() const{ return seconds>0? ops/seconds : 0; }
+
+    std::string label() const{
+        std::ostringstream out;
+        out << name << "/threads:" << params.threads << "/read:" << params.readPct;
+        if(params.keys) out << "/dist:" << distributionName(params.dist) << "/keys:" << params.keys;
+        out << "/value:" << params.valueSize;
+        return out.str();
+    }
+};
+
+// Every registered benchmark runs an Adapter that maps the abstract read and
+// write operations onto one container. Keyless adapters (queues, stacks) set
+// keys to 0 so the distribution axis is not swept for them.
+struct Benchmark{
+    std::string name;
+    bool keyed;
+    std::function<BenchResult(const BenchParams&)> run;
+};
+
+inline std::vector<Benchmark>& registry(){
+    static std::vector<Benchmark> benches;
+    return benches;
+}
+
+inline bool registerBenchmark(std::string name, const bool keyed, std::function<BenchResult(const BenchParams&)> fn){
+    registry().push_back(Benchmark{std::move(name), keyed, std::move(fn)});
+    return true;
+}
+
+constexpr std::uint64_t keylessPrefill=10000;
+
+template<typename Adapter>
+BenchResult runAdapter(const std::string& name, const BenchParams& params){
+    Adapter adapter(params);
+    const KeyGenerator keys(params.dist, params.keys? params.keys : 1);
+    adapter.prefill(params.keys? keys.size() : keylessPrefill);
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<LatencyRecorder> latencies(params.threads);
+    std::vector<std::uint64_t> ops(params.threads, 0);
+
+    std::vector<std::thread> workers;
+    for(int t=0; t<params.threads; ++t){
+        workers.emplace_back([&, t]{
+            std::mt19937_64 rng(0x9e3779b97f4a7c15ULL*(t+1));
+            LatencyRecorder& lat=latencies[t];
+            std::uint64_t done=0;
+            ready.fetch_add(1);
+            while(!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            while(!stop.load(std::memory_order_relaxed)){
+                for(int i=0; i<64; ++i){
+                    const std::uint64_t key=keys(rng);
+                    const std::uint64_t dice=rng();
+                    const std::uint64_t start=nowNs();
+                    if(static_cast<int>(dice%100)<params.readPct){
+                        adapter.read(key);
+                    }else{
+                        adapter.write(key, (dice>>32) & 1);
+                    }
+                    lat.record(nowNs()-start);
+                }
+                done+=64;
+            }
+            ops[t]=done;
+        });
+    }
+
+    while(ready.load()<params.threads) std::this_thread::yield();
+    const auto start=std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(params.minTime));
+    stop.store(true);
+    for(auto& w : workers) w.join();
+    const auto end=std::chrono::steady_clock::now();
+
+    BenchResult res;
+    res.name=name;
+    res.params=params;
+    res.seconds=std::chrono::duration<double>(end-start).count();
+    LatencyRecorder all;
+    for(int t=0; t<params.threads; ++t){
+        all.merge(latencies[t]);
+        res.ops+=ops[t];
+    }
+    res.p50=all.percentile(0.5);
+    res.p99=all.percentile(0.99);
+    res.p999=all.percentile(0.999);
+    res.maxNs=all.max();
+    return res;
+}
+
+inline void printHeader(std::ostream& out){
+    out << std::left << std::setw(72) << "Benchmark" << std::right
+        << std::setw(14) << "ops/s" << std::setw(10) << "p50(ns)" << std::setw(10) << "p99(ns)"
+        << std::setw(11) << "p999(ns)" << "\n";
+    out << std::string(117, '-') << "\n";
+}
+
+inline void printResult(std::ostream& out, const BenchResult& r){
+    out << std::left << std::setw(72) << r.label() << std::right
+        << std::setw(14) << static_cast<std::uint64_t>(r.opsPerSec()) << std::setw(10) << r.p50
+        << std::setw(10) << r.p99 << std::setw(11) << r.p999 << "\n";
+}
+
+inline void printJson(std::ostream& out, const std::vector<BenchResult>& results){
+    out << "{\n  \"benchmarks\": [\n";
+    for(std::size_t i=0; i<results.size(); ++i){
+        const BenchResult& r=results[i];
+        out << "    {\"name\": \"" << r.label() << "\", \"container\": \"" << r.name << "\""
+            << ", \"threads\": " << r.params.threads << ", \"read_pct\": " << r.params.readPct
+            << ", \"distribution\": \"" << distributionName(r.params.dist) << "\""
+            << ", \"keys\": " << r.params.keys << ", \"value_size\": " << r.params.valueSize
+            << ", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+            << ", \"ops_per_sec\": " << r.opsPerSec() << ", \"p50_ns\": " << r.p50
+            << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999 << ", \"max_ns\": " << r.maxNs << "}"
+            << (i+1<results.size()? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/Harness.hpp"
+
+#include "ThreadSafeQueue.hpp"
+#include "ThreadSafeQueue1.hpp"
+#include "ThreadSafeStack.hpp"
+#include "ThreadSafeSList.hpp"
+#include "ThreadSafeSortList.hpp"
+#include "SkipSet.hpp"
+#include "BTree.hpp"
+#include "ThreadSafeMapSS.hpp"
+
+template<std::size_t N>
+struct Payload{
+    long key;
+    std::array<char, N-sizeof(long)> pad;
+
+    Payload(long k=0): key{k}, pad{} {}
+
+    bool operator<(const Payload& p) const{ return key<p.key; }
+    bool operator>(const Payload& p) const{ return key>p.key; }
+    bool operator==(const Payload& p) const{ return key==p.key; }
+    bool operator!=(const Payload& p) const{ return key!=p.key; }
+
+    friend std::ostream& operator<<(std::ostream& out, const Payload& p){
+        return out << p.key;
+    }
+};
+
+template<typename P>
+struct QueueAdapter{
+    ThreadSafeQueue<P> q;
+
+    explicit QueueAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; ++i) q.push(P(i));
+    }
+    void read(const std::uint64_t){
+        P v;
+        q.tryDequeue(v);
+    }
+    void write(const std::uint64_t k, bool){
+        q.push(P(k));
+    }
+};
+
+template<typename P>
+struct Queue1Adapter{
+    ThreadSafeQueue1<P> q;
+
+    explicit Queue1Adapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; ++i) q.push(P(i));
+    }
+    void read(const std::uint64_t){
+        P v;
+        q.tryPop(v);
+    }
+    void write(const std::uint64_t k, bool){
+        q.push(P(k));
+    }
+};
+
+template<typename P>
+struct StackAdapter{
+    ThreadSafeStack<P> s;
+
+    explicit StackAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; ++i) s.push(P(i));
+    }
+    void read(const std::uint64_t){
+        try{
+            P v;
+            s.pop(v);
+        }catch(EmptyStackException&){
+        }
+    }
+    void write(const std::uint64_t k, bool){
+        s.push(P(k));
+    }
+};
+
+template<typename P>
+struct SListAdapter{
+    ThreadSafeSList<P> l;
+
+    explicit SListAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; i+=2) l.push_front(P(i));
+    }
+    void read(const std::uint64_t k){
+        l.find_first_if([k](const P& p){ return p.key==static_cast<long>(k); });
+    }
+    void write(const std::uint64_t k, const bool insert){
+        if(insert){
+            l.push_front(P(k));
+            return;
+        }
+        try{
+            l.remove_if([k](const P& p){ return p.key==static_cast<long>(k); });
+        }catch(EmptyListException&){
+        }
+    }
+};
+
+template<typename P>
+struct SortListAdapter{
+    ThreadSafeSorteList<P> l;
+
+    explicit SortListAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; i+=2) l.add(P(i));
+    }
+    void read(const std::uint64_t k){
+        l.find(P(k));
+    }
+    void write(const std::uint64_t k, const bool insert){
+        if(insert) l.add(P(k));
+        else l.remove(P(k));
+    }
+};
+
+template<typename P>
+struct SkipSetAdapter{
+    SkipSet<long, P> s;
+
+    explicit SkipSetAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; i+=2) s.add(std::pair<long, P>(i, P(i)));
+    }
+    void read(const std::uint64_t k){
+        P v;
+        s.find(k, v);
+    }
+    void write(const std::uint64_t k, const bool insert){
+        if(insert){
+            s.add(std::pair<long, P>(k, P(k)));
+        }else{
+            P v;
+            s.remove(k, v);
+        }
+    }
+};
+
+// Values are the key itself: BTree holds only lock-free scalar values, so
+// the payload size does not apply.
+template<typename P>
+struct BTreeAdapter{
+    BTree<long, long> t;
+
+    explicit BTreeAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; i+=2) t.add(std::pair<long, long>(i, i));
+    }
+    void read(const std::uint64_t k){
+        long v;
+        t.find(k, v);
+    }
+    void write(const std::uint64_t k, const bool insert){
+        if(insert) t.add(std::pair<long, long>(k, k));
+        else t.remove(k);
+    }
+};
+
+template<typename P>
+struct MapAdapter{
+    ThreadSafeMapSS<long, P> m;
+
+    explicit MapAdapter(const BenchParams&) {}
+    void prefill(const std::uint64_t n){
+        for(std::uint64_t i=0; i<n; i+=2) m.add_or_update(i, P(i));
+    }
+    void read(const std::uint64_t k){
+        m.find(k);
+    }
+    void write(const std::uint64_t k, const bool insert){
+        if(insert) m.add_or_update(k, P(k));
+        else m.remove(k);
+    }
+};
+
+template<template<typename> class Adapter>
+BenchResult runSized(const std::string& name, const BenchParams& params){
+    switch(params.valueSize){
+        case 8: return runAdapter<Adapter<Payload<8>>>(name, params);
+        case 64: return runAdapter<Adapter<Payload<64>>>(name, params);
+        case 256: return runAdapter<Adapter<Payload<256>>>(name, params);
+        case 1024: return runAdapter<Adapter<Payload<1024>>>(name, params);
+    }
+    throw std::invalid_argument("unsupported value size "+std::to_string(params.valueSize));
+}
+
+#define REGISTER_CONTAINER(name, adapter, keyed) \
+    static const bool registered_##adapter=registerBenchmark(name, keyed, [](const BenchParams& p){ \
+        return runSized<adapter>(name, p); \
+    })
+
+REGISTER_CONTAINER("ThreadSafeQueue", QueueAdapter, false);
+REGISTER_CONTAINER("ThreadSafeQueue1", Queue1Adapter, false);
+REGISTER_CONTAINER("ThreadSafeStack", StackAdapter, false);
+REGISTER_CONTAINER("ThreadSafeSList", SListAdapter, true);
+REGISTER_CONTAINER("ThreadSafeSorteList", SortListAdapter, true);
+REGISTER_CONTAINER("SkipSet", SkipSetAdapter, true);
+REGISTER_CONTAINER("BTree", BTreeAdapter, true);
+REGISTER_CONTAINER("ThreadSafeMapSS", MapAdapter, true);
+
+template<typename T, typename Parse>
+std::vector<T> parseList(const std::string& s, Parse parse){
+    std::vector<T> res;
+    std::stringstream in(s);
+    std::string item;
+    while(std::getline(in, item, ',')) res.push_back(parse(item));
+    return res;
+}
+
+void usage(){
+    std::cout << "usage: containerbench [--filter=REGEX] [--threads=1,2,4,8] [--reads=0,50,95]\n"
+                 "                      [--dist=uniform,zipf] [--values=8,64,256,1024]\n"
+                 "                      [--keys=N] [--list-keys=N] [--min-time=SEC]\n"
+                 "                      [--format=console|json] [--out=FILE] [--list]\n";
+}
+
+int main(int argc, char** argv){
+    std::regex filter(".*");
+    std::vector<int> threads{1, 2, 4, 8};
+    std::vector<int> reads{0, 50, 95};
+    std::vector<KeyDistribution> dists{KeyDistribution::Uniform, KeyDistribution::Zipfian};
+    std::vector<std::size_t> values{8, 64, 256};
+    std::uint64_t keys=100000;
+    std::uint64_t listKeys=1000;
+    double minTime=0.2;
+    bool json=false;
+    bool list=false;
+    std::string outFile;
+
+    for(int i=1; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        try{
+            if(key=="--filter") filter=std::regex(val);
+            else if(key=="--threads") threads=parseList<int>(val, [](const std::string& s){ return std::stoi(s); });
+            else if(key=="--reads") reads=parseList<int>(val, [](const std::string& s){ return std::stoi(s); });
+            else if(key=="--values") values=parseList<std::size_t>(val, [](const std::string& s){ return std::stoul(s); });
+            else if(key=="--dist"){
+                dists=parseList<KeyDistribution>(val, [](const std::string& s){
+                    KeyDistribution d;
+                    if(!parseDistribution(s, d)) throw std::invalid_argument("unknown distribution "+s);
+                    return d;
+                });
+            }
+            else if(key=="--keys") keys=std::stoull(val);
+            else if(key=="--list-keys") listKeys=std::stoull(val);
+            else if(key=="--min-time") minTime=std::stod(val);
+            else if(key=="--format") json= val=="json";
+            else if(key=="--out") outFile=val;
+            else if(key=="--list") list=true;
+            else{
+                usage();
+                return arg=="--help"? 0 : 1;
+            }
+        }catch(std::exception& ex){
+            std::cerr << "Bad argument " << arg << ": " << ex.what() << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<BenchParams> plan;
+    std::vector<const Benchmark*> owners;
+    for(const Benchmark& b : registry()){
+        if(!std::regex_search(b.name, filter)) continue;
+        for(int t : threads) for(int r : reads) for(std::size_t v : values){
+            for(std::size_t d=0; d<(b.keyed? dists.size() : 1); ++d){
+                BenchParams p;
+                p.threads=t;
+                p.readPct=r;
+                p.valueSize=v;
+                p.minTime=minTime;
+                p.dist= b.keyed? dists[d] : KeyDistribution::Uniform;
+                p.keys= !b.keyed? 0 : (b.name.find("List")!=std::string::npos? listKeys : keys);
+                plan.push_back(p);
+                owners.push_back(&b);
+            }
+        }
+    }
+
+    if(list){
+        for(std::size_t i=0; i<plan.size(); ++i){
+            BenchResult r;
+            r.name=owners[i]->name;
+            r.params=plan[i];
+            std::cout << r.label() << "\n";
+        }
+        return 0;
+    }
+
+    std::vector<BenchResult> results;
+    if(!json) printHeader(std::cout);
+    for(std::size_t i=0; i<plan.size(); ++i){
+        try{
+            results.push_back(owners[i]->run(plan[i]));
+            if(!json) printResult(std::cout, results.back());
+        }catch(std::exception& ex){
+            std::cerr << "Exception: " << ex.what() << "\n";
+        }
+    }
+
+    if(json && outFile.empty()) printJson(std::cout, results);
+    if(!outFile.empty()){
+        std::ofstream out(outFile);
+        if(!out){
+            std::cerr << "Unable to open " << outFile << "\n";
+            return 1;
+        }
+        printJson(out, results);
+    }
+    return 0;
+}
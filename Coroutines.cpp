@@ -0,0 +1,37 @@
+#include <iostream>
+
+#include "include/Coro.hpp"
+
+#ifdef COROUTINES
+
+Task<void> produce(AsyncQueue<int>& q, const int n){
+    for(int i=1; i<=n; ++i){
+        if(!co_await q.push(i)) break;
+    }
+    q.close();
+}
+
+Task<long> consume(AsyncQueue<int>& q){
+    long sum=0;
+    while(std::optional<int> v=co_await q.pop()) sum+=*v;
+    co_return sum;
+}
+
+Task<long> pipeline(CoroExecutor& ex, const int n){
+    AsyncQueue<int> q(ex, 4);
+    spawn(ex, produce(q, n));
+    co_return co_await consume(q);
+}
+
+int main(){
+    CoroExecutor ex(2);
+    std::cout << "sum of 1.." << 1000 << " through a 4-slot queue: " << syncWait(ex, pipeline(ex, 1000)) << "\n";
+}
+
+#else
+
+int main(){
+    std::cout << "coroutines need a C++20 build, e.g. g++ -std=c++20 Coroutines.cpp -lpthread\n";
+}
+
+#endif
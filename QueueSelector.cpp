@@ -0,0 +1,46 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "include/QueueSelector.hpp"
+
+int main(){
+    ThreadSafeQueue<int> urgent;
+    ThreadSafeQueue1<int> bulk;
+    QueueSelector<int> selector(SelectPolicy::Weighted);
+    const std::size_t urgentIdx=selector.add(urgent, 3);
+    const std::size_t bulkIdx=selector.add(bulk, 1);
+
+    std::vector<std::thread> producers;
+    producers.emplace_back([&urgent]{
+        for(int i=0; i<30; ++i) urgent.push(i);
+    });
+    producers.emplace_back([&bulk]{
+        for(int i=100; i<130; ++i) bulk.push(i);
+    });
+
+    std::vector<std::string> order;
+    std::thread consumer{[&]{
+        int val;
+        std::size_t from;
+        while(selector.select(val, from)){
+            order.push_back((from==urgentIdx? "u" : "b")+std::to_string(val));
+        }
+    }};
+
+    for(auto& p : producers){
+        if(p.joinable()) p.join();
+    }
+    urgent.close();
+    bulk.close();
+    consumer.join();
+
+    std::size_t fromUrgent{0};
+    for(auto& o : order){
+        std::cout << o << "  ";
+        if(o[0]=='u') ++fromUrgent;
+    }
+    std::cout << "\nurgent: " << fromUrgent << " bulk: " << order.size()-fromUrgent
+              << " (queue " << bulkIdx << " is bulk)\n";
+}
@@ -1,10 +1,10 @@
 #include "include/Person.hpp"
 
-Person::Person(): SINLen{9}, cityLen{20}, fnameLen{20}, lnameLen{20} {
-    SIN = new char[SINLen+1];
-    fname = new char[fnameLen+1];
-    lname = new char[lnameLen+1];
-    city = new char[cityLen+1];
+Person::Person(): SINLen{9}, cityLen{20}, fnameLen{20}, lnameLen{20}, year{0}, salary{0} {
+    SIN = new char[SINLen+1]();
+    fname = new char[fnameLen+1]();
+    lname = new char[lnameLen+1]();
+    city = new char[cityLen+1]();
 }
 
 Person::Person(const char* sin, const char* f, const char* l, const char* c, const int y, const long s):
@@ -17,6 +17,28 @@ Person() {
     salary=s;
 }
 
+Person::Person(const Person& pr): Person() {
+    *this=pr;
+}
+
+Person& Person::operator=(const Person& pr) {
+    if(this==&pr) return *this;
+    memcpy(SIN, pr.SIN, SINLen+1);
+    memcpy(fname, pr.fname, fnameLen+1);
+    memcpy(lname, pr.lname, lnameLen+1);
+    memcpy(city, pr.city, cityLen+1);
+    year=pr.year;
+    salary=pr.salary;
+    return *this;
+}
+
+Person::~Person() {
+    delete[] SIN;
+    delete[] fname;
+    delete[] lname;
+    delete[] city;
+}
+
 std::ostream& Person::writeToConsole(std::ostream& out) {
     SIN[SINLen]=fname[fnameLen]=lname[lnameLen]=city[cityLen]='\0';
     out << "SIN: " << SIN << ", fname: " << fname << ", lname: " << lname << ", city: " << city << ", year: " << year << ", salary: " << salary;
@@ -78,7 +100,7 @@ void Person::readInfoWithoutSIN(){
 
 }
 
-void Person::readFromFile(std::fstream& fin) {
+void Person::readFromFile(std::istream& fin) {
     fin.read(SIN, SINLen);
     fin.read(fname, fnameLen);
     fin.read(lname, lnameLen);
@@ -87,7 +109,7 @@ void Person::readFromFile(std::fstream& fin) {
     fin.read(reinterpret_cast<char*>(&salary), sizeof(long));
 }
 
-void Person::writeToFile(std::fstream& fout) {
+void Person::writeToFile(std::ostream& fout) {
     fout.write(SIN, SINLen);
     fout.write(fname, fnameLen);
     fout.write(lname, lnameLen);
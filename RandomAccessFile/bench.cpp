@@ -0,0 +1,994 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/Person.hpp"
+#include "include/FileMang.hpp"
+#include "include/WorkloadGen.hpp"
+#include "include/ParallelScan.hpp"
+#include "include/ColumnSnapshot.hpp"
+#include "include/PackedFile.hpp"
+#include "include/ShardedFileMang.hpp"
+#include "include/AsyncStore.hpp"
+#include "KeyGenerator.hpp"
+#include "LatencyRecorder.hpp"
+
+using namespace workload;
+
+struct RunConfig{
+    std::string file;
+    Mix mix;
+    std::uint64_t ops=100000;
+    int threads=1;
+    KeyDistribution dist=KeyDistribution::Zipfian;
+    bool json=false;
+    bool logged=true;
+    bool indexed=false;
+    double bloomBits=0;
+    std::uint64_t compactRate=0;
+    std::size_t cachePages=4096;
+};
+
+void usage(){
+    std::cout << "usage: rabench generate FILE RECORDS [SEED]\n"
+                 "       rabench run FILE [--workload=A|B|C|D|E|F] [--ops=N] [--threads=N]\n"
+                 "                        [--dist=zipf|uniform] [--format=console|json]\n"
+                 "                        [--no-wal] [--indexes] [--compact=KB_PER_SEC]\n"
+                 "                        [--cache-pages=N] [--bloom[=BITS_PER_KEY]]\n"
+                 "       rabench async FILE [--ops=N] [--depth=N] [--backend=auto|uring|threads] [--cache-pages=N]\n"
+                 "       rabench coro FILE [--ops=N] [--waiters=N] [--threads=N] [--backend=auto|uring|threads]\n"
+                 "                        [--cache-pages=N]   (C++20 builds only)\n"
+                 "       rabench pack FILE [--out=PATH] [--group=none|city|year] [--threads=N]\n"
+                 "                         [--city=NAME] [--year=LO:HI] [--salary=LO:HI]\n"
+                 "       rabench shards FILE [--shards=N] [--out=BASE] [--ops=N] [--batch=N] [--threads=N]\n"
+                 "       rabench views FILE [--ops=N] [--per-txn=N] [--cache-pages=N]\n"
+                 "       rabench compact FILE [--erase=FRACTION] [--rate=KB_PER_SEC] [--threads=N]\n"
+                 "       rabench query FILE [--city=NAME] [--year=LO:HI] [--salary=LO:HI]\n"
+                 "       rabench scan FILE [--group=none|city|year] [--threads=N] [--chunk-kb=N] [--mmap]\n"
+                 "                         [--city=NAME] [--year=LO:HI] [--salary=LO:HI]\n"
+                 "       rabench columns FILE [--out=PATH] [--group=none|city|year] [--threads=N]\n"
+                 "                            [--city=NAME] [--year=LO:HI] [--salary=LO:HI]\n";
+}
+
+void declareIndexes(FileMang<Person>& db){
+    db.addHashIndex("city", [](const Person& p){ return p.getCity(); });
+    db.addOrderedIndex("year", [](const Person& p){ return static_cast<long>(p.getYear()); });
+    db.addOrderedIndex("salary", [](const Person& p){ return p.getSalary(); });
+}
+
+void parseRange(const std::string& val, long& lo, long& hi){
+    const std::size_t colon=val.find(':');
+    if(colon==std::string::npos) throw std::invalid_argument("expected LO:HI, got "+val);
+    lo=std::stol(val.substr(0, colon));
+    hi=std::stol(val.substr(colon+1));
+}
+
+int query(const std::string& file, int argc, char** argv){
+    IndexQuery q;
+    std::string city;
+    bool byCity=false, byYear=false, bySalary=false;
+    long yearLo=0, yearHi=0, salaryLo=0, salaryHi=0;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--city"){
+            city=val;
+            byCity=true;
+            q.equals("city", val);
+        }else if(key=="--year"){
+            parseRange(val, yearLo, yearHi);
+            byYear=true;
+            q.between("year", yearLo, yearHi);
+        }else if(key=="--salary"){
+            parseRange(val, salaryLo, salaryHi);
+            bySalary=true;
+            q.between("salary", salaryLo, salaryHi);
+        }else{
+            usage();
+            return 1;
+        }
+    }
+
+    std::uint64_t scanned=0, scanMatches=0;
+    const auto scanStart=std::chrono::steady_clock::now();
+    {
+        std::ifstream in(file, std::ios::binary);
+        if(!in.is_open()) throw UnableToOpenFileException("Unable to open "+file);
+        Person p;
+        while(true){
+            p.readFromFile(in);
+            if(in.eof()) break;
+            ++scanned;
+            if(p.isRemoved()) continue;
+            if(byCity && p.getCity()!=city) continue;
+            if(byYear && (p.getYear()<yearLo || p.getYear()>yearHi)) continue;
+            if(bySalary && (p.getSalary()<salaryLo || p.getSalary()>salaryHi)) continue;
+            ++scanMatches;
+        }
+    }
+    const double scanSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-scanStart).count();
+
+    FileMang<Person> db(file);
+    const IoStats opened=db.ioStats();
+    const auto indexStart=std::chrono::steady_clock::now();
+    declareIndexes(db);
+    const double indexSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-indexStart).count();
+    const IoStats indexed=db.ioStats();
+
+    const auto queryStart=std::chrono::steady_clock::now();
+    const std::vector<Person> rows=db.select(q);
+    const double querySecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-queryStart).count();
+    const IoStats done=db.ioStats();
+
+    Person p;
+    std::cout << "full scan: " << scanMatches << " matches, " << scanned*p.size() << " bytes read in " << scanSecs << " s\n";
+    std::cout << "indexes: " << (indexed.bytesRead==opened.bytesRead? "loaded" : "built") << " in " << indexSecs << " s\n";
+    std::cout << "indexed query: " << rows.size() << " matches, " << done.bytesRead-indexed.bytesRead
+              << " bytes read in " << querySecs << " s\n";
+    return rows.size()==scanMatches? 0 : 1;
+}
+
+int generate(const std::string& file, const std::uint64_t n, const std::uint64_t seed){
+    const auto start=std::chrono::steady_clock::now();
+    generatePersonFile(file, n, seed);
+    const double secs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    Person p;
+    std::cout << "generated " << n << " records (" << n*p.size() << " bytes) in " << secs << " s\n";
+    return 0;
+}
+
+int run(const RunConfig& cfg){
+    const auto openStart=std::chrono::steady_clock::now();
+    FileMang<Person> db(cfg.file, cfg.logged, std::chrono::seconds(1), cfg.cachePages);
+    if(cfg.indexed) declareIndexes(db);
+    if(cfg.bloomBits>0) db.addSinFilter(cfg.bloomBits);
+    if(cfg.compactRate) db.startCompaction(cfg.compactRate<<10);
+    const double coldStart=std::chrono::duration<double>(std::chrono::steady_clock::now()-openStart).count();
+    const IoStats openIo=db.ioStats();
+    const BufferPoolStats openCache=db.cacheStats();
+    const std::uint64_t loaded=db.count();
+
+    const KeyGenerator keys(cfg.dist, loaded? loaded : 1);
+    const ZipfianGenerator recent(loaded? loaded : 1);
+    std::atomic<std::uint64_t> nextKey{loaded};
+    const std::uint64_t numOps=static_cast<std::uint64_t>(Op::Count);
+    std::vector<std::vector<LatencyRecorder>> latencies(cfg.threads, std::vector<LatencyRecorder>(numOps));
+
+    const auto start=std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(int t=0; t<cfg.threads; ++t){
+        workers.emplace_back([&, t]{
+            std::mt19937_64 rng(0x5bd1e995ULL*(t+1));
+            const std::uint64_t share=cfg.ops/cfg.threads+(static_cast<std::uint64_t>(t)<cfg.ops%cfg.threads? 1 : 0);
+            Person rec;
+            for(std::uint64_t i=0; i<share; ++i){
+                const Op op=chooseOp(cfg.mix, rng);
+                std::uint64_t idx;
+                if(cfg.mix.latest){
+                    const std::uint64_t newest=nextKey.load(std::memory_order_relaxed);
+                    const std::uint64_t back=recent(rng);
+                    idx= back<newest? newest-1-back : 0;
+                }else{
+                    idx=keys(rng);
+                }
+
+                const std::uint64_t begin=nowNs();
+                switch(op){
+                    case Op::Get:
+                        db.get(sinOf(idx), rec);
+                        break;
+                    case Op::Update:{
+                        Person p=makePerson(sinOf(idx), rng);
+                        db.update(p);
+                        break;
+                    }
+                    case Op::Insert:{
+                        Person p=makePerson(sinOf(nextKey.fetch_add(1)), rng);
+                        db.insert(p);
+                        break;
+                    }
+                    case Op::Delete:
+                        db.erase(sinOf(idx));
+                        break;
+                    case Op::ReadModifyWrite:
+                        if(db.get(sinOf(idx), rec)){
+                            Person p=makePerson(sinOf(idx), rng);
+                            db.update(p);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                latencies[t][static_cast<int>(op)].record(nowNs()-begin);
+            }
+        });
+    }
+    for(auto& w : workers) w.join();
+    const double secs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    const IoStats io=db.ioStats();
+    const double readPerOp=cfg.ops? double(io.bytesRead-openIo.bytesRead)/cfg.ops : 0;
+    const double writePerOp=cfg.ops? double(io.bytesWritten-openIo.bytesWritten)/cfg.ops : 0;
+    const double walPerOp=cfg.ops? double(io.walBytes-openIo.walBytes)/cfg.ops : 0;
+    const std::uint64_t walRecords=io.walRecords-openIo.walRecords;
+    const std::uint64_t walSyncs=io.walSyncs-openIo.walSyncs;
+    const double groupSize=walSyncs? double(walRecords)/walSyncs : 0;
+    BufferPoolStats cache=db.cacheStats();
+    cache.hits-=openCache.hits;
+    cache.misses-=openCache.misses;
+    cache.evictions-=openCache.evictions;
+    cache.writebacks-=openCache.writebacks;
+    cache.bytesRead-=openCache.bytesRead;
+    cache.bytesWritten-=openCache.bytesWritten;
+
+    std::vector<LatencyRecorder> merged(numOps);
+    for(auto& perThread : latencies){
+        for(std::uint64_t o=0; o<numOps; ++o) merged[o].merge(perThread[o]);
+    }
+
+    if(cfg.json){
+        std::cout << "{\"workload\": \"" << cfg.mix.name << "\", \"records\": " << loaded
+                  << ", \"cold_start_s\": " << coldStart << ", \"cold_start_bytes_read\": " << openIo.bytesRead
+                  << ", \"threads\": " << cfg.threads << ", \"ops\": " << cfg.ops << ", \"seconds\": " << secs
+                  << ", \"ops_per_sec\": " << cfg.ops/secs << ", \"bytes_read_per_op\": " << readPerOp
+                  << ", \"bytes_written_per_op\": " << writePerOp << ", \"wal_bytes_per_op\": " << walPerOp
+                  << ", \"wal_records\": " << walRecords << ", \"wal_syncs\": " << walSyncs
+                  << ", \"wal_group_size\": " << groupSize << ", \"cache_pages\": " << cache.capacity
+                  << ", \"cache_hit_rate\": " << cache.hitRate() << ", \"cache_evictions\": " << cache.evictions
+                  << ", \"cache_writebacks\": " << cache.writebacks << ", \"device_bytes_read\": " << cache.bytesRead
+                  << ", \"device_bytes_written\": " << cache.bytesWritten
+                  << ", \"filtered_lookups\": " << io.filteredLookups-openIo.filteredLookups << ", \"latency\": {";
+        bool first=true;
+        for(std::uint64_t o=0; o<numOps; ++o){
+            if(!merged[o].count()) continue;
+            std::cout << (first? "" : ", ") << "\"" << opName(static_cast<Op>(o)) << "\": {\"count\": " << merged[o].count()
+                      << ", \"p50_ns\": " << merged[o].percentile(0.5) << ", \"p99_ns\": " << merged[o].percentile(0.99)
+                      << ", \"p999_ns\": " << merged[o].percentile(0.999) << "}";
+            first=false;
+        }
+        std::cout << "}}\n";
+        return 0;
+    }
+
+    std::cout << "cold start (fillPos): " << loaded << " records in " << coldStart << " s, "
+              << openIo.bytesRead << " bytes read\n";
+    std::cout << "workload " << cfg.mix.name << ", " << cfg.threads << " thread(s), " << cfg.ops << " ops in "
+              << secs << " s: " << static_cast<std::uint64_t>(cfg.ops/secs) << " ops/s\n";
+    std::cout << "bytes read/op: " << readPerOp << ", bytes written/op: " << writePerOp << "\n";
+    std::cout << "cache: " << cache.capacity << " x " << cache.pageBytes << " B pages, hit rate " << cache.hitRate()
+              << ", " << cache.evictions << " evictions, " << cache.writebacks << " write-backs, device read/write "
+              << cache.bytesRead << "/" << cache.bytesWritten << " bytes\n";
+    if(cfg.bloomBits>0) std::cout << "sin filter: " << io.filteredLookups-openIo.filteredLookups << " lookups answered without activePos\n";
+    const SpaceStats space=db.space();
+    std::cout << "file: " << space.fileBytes << " bytes, live: " << space.liveBytes << " bytes, holes: " << space.holes
+              << ", relocated: " << io.relocated-openIo.relocated << "\n";
+    if(cfg.logged){
+        std::cout << "wal bytes/op: " << walPerOp << ", " << walRecords << " records in " << walSyncs
+                  << " syncs (" << groupSize << " per group commit)\n";
+    }
+    std::cout << std::left << std::setw(10) << "op" << std::right << std::setw(12) << "count"
+              << std::setw(12) << "p50(ns)" << std::setw(12) << "p99(ns)" << std::setw(12) << "p999(ns)" << "\n";
+    for(std::uint64_t o=0; o<numOps; ++o){
+        if(!merged[o].count()) continue;
+        std::cout << std::left << std::setw(10) << opName(static_cast<Op>(o)) << std::right
+                  << std::setw(12) << merged[o].count() << std::setw(12) << merged[o].percentile(0.5)
+                  << std::setw(12) << merged[o].percentile(0.99) << std::setw(12) << merged[o].percentile(0.999) << "\n";
+    }
+    return 0;
+}
+
+struct RowFilter{
+    std::string city;
+    bool byCity=false, byYear=false, bySalary=false;
+    long yearLo=0, yearHi=0, salaryLo=0, salaryHi=0;
+
+    bool parse(const std::string& key, const std::string& val){
+        if(key=="--city"){
+            city=val;
+            byCity=true;
+        }else if(key=="--year"){
+            parseRange(val, yearLo, yearHi);
+            byYear=true;
+        }else if(key=="--salary"){
+            parseRange(val, salaryLo, salaryHi);
+            bySalary=true;
+        }else{
+            return false;
+        }
+        return true;
+    }
+
+    bool accept(const std::string_view c, const int year, const long salary) const{
+        return (!byCity || c==city) && (!byYear || (year>=yearLo && year<=yearHi))
+            && (!bySalary || (salary>=salaryLo && salary<=salaryHi));
+    }
+};
+
+GroupBy parseGroup(const std::string& val){
+    if(val=="none") return GroupBy::None;
+    if(val=="city") return GroupBy::City;
+    if(val=="year") return GroupBy::Year;
+    throw std::invalid_argument("unknown grouping "+val);
+}
+
+void printGroups(const SalaryGroups& groups){
+    std::cout << std::left << std::setw(16) << "group" << std::right << std::setw(12) << "count"
+              << std::setw(18) << "sum" << std::setw(14) << "avg" << "\n";
+    for(const auto& g : groups){
+        std::cout << std::left << std::setw(16) << g.first << std::right << std::setw(12) << g.second.count
+                  << std::setw(18) << g.second.sum << std::setw(14) << std::fixed << std::setprecision(2)
+                  << g.second.avg() << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+bool sameGroups(const SalaryGroups& a, const SalaryGroups& b){
+    if(a.size()!=b.size()) return false;
+    for(const auto& g : a){
+        auto it=b.find(g.first);
+        if(it==b.end() || it->second.count!=g.second.count || it->second.sum!=g.second.sum) return false;
+    }
+    return true;
+}
+
+int scan(const std::string& file, int argc, char** argv){
+    GroupBy by=GroupBy::City;
+    ScanOptions opt;
+    unsigned int threads=std::thread::hardware_concurrency();
+    RowFilter filter;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--group"){
+            by=parseGroup(val);
+        }else if(key=="--threads"){
+            threads=std::stoul(val);
+        }else if(key=="--chunk-kb"){
+            opt.chunkBytes=std::stoul(val)<<10;
+        }else if(key=="--mmap"){
+            opt.mmap=true;
+        }else if(!filter.parse(key, val)){
+            usage();
+            return 1;
+        }
+    }
+
+    SalaryGroups serial;
+    const auto serialStart=std::chrono::steady_clock::now();
+    {
+        std::ifstream in(file, std::ios::binary);
+        if(!in.is_open()) throw UnableToOpenFileException("Unable to open "+file);
+        Person p;
+        while(true){
+            p.readFromFile(in);
+            if(in.eof()) break;
+            if(p.isRemoved() || !filter.accept(p.getCity(), p.getYear(), p.getSalary())) continue;
+            const std::string key= by==GroupBy::City? p.getCity() : by==GroupBy::Year? std::to_string(p.getYear()) : "all";
+            serial[key].add(p.getSalary());
+        }
+    }
+    const double serialSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-serialStart).count();
+
+    FileMang<Person> db(file);
+    ThreadPool pool(threads? threads : 1);
+    ScanStats stats;
+    const auto start=std::chrono::steady_clock::now();
+    const SalaryGroups groups=aggregateSalary(db, pool, by, [&](const PersonView& r){
+        return filter.accept(r.city(), r.year(), r.salary());
+    }, opt, &stats);
+    const double secs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    const bool same=sameGroups(groups, serial);
+    printGroups(groups);
+    std::cout << "serial stream scan: " << serialSecs << " s\n";
+    std::cout << "parallel scan: " << stats.records << " records, " << stats.chunks << " chunks on " << pool.size()
+              << " threads" << (opt.mmap? " (mmap)" : "") << " in " << secs << " s, "
+              << (secs>0? stats.bytes/secs/(1<<20) : 0) << " MiB/s\n";
+    if(!same) std::cout << "MISMATCH against the serial scan\n";
+    return same? 0 : 1;
+}
+
+template<typename Fn>
+double bestOf(const int reps, Fn fn){
+    double best=0;
+    for(int r=0; r<reps; ++r){
+        const auto start=std::chrono::steady_clock::now();
+        fn();
+        const double secs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        if(r==0 || secs<best) best=secs;
+    }
+    return best;
+}
+
+int columnar(const std::string& file, int argc, char** argv){
+    GroupBy by=GroupBy::City;
+    unsigned int threads=std::thread::hardware_concurrency();
+    std::string out=file+".col";
+    RowFilter filter;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--group") by=parseGroup(val);
+        else if(key=="--threads") threads=std::stoul(val);
+        else if(key=="--out") out=val;
+        else if(!filter.parse(key, val)){
+            usage();
+            return 1;
+        }
+    }
+    ColumnFilter cf;
+    if(filter.byCity){
+        cf.byCity=true;
+        cf.city=filter.city;
+    }
+    if(filter.byYear){
+        cf.yearLo=static_cast<int>(filter.yearLo);
+        cf.yearHi=static_cast<int>(filter.yearHi);
+    }
+    if(filter.bySalary){
+        cf.salaryLo=filter.salaryLo;
+        cf.salaryHi=filter.salaryHi;
+    }
+
+    FileMang<Person> db(file);
+    ThreadPool pool(threads? threads : 1);
+    SalaryGroups rows;
+    const double rowSecs=bestOf(1, [&]{
+        rows=aggregateSalary(db, pool, by, [&](const PersonView& r){
+            return filter.accept(r.city(), r.year(), r.salary());
+        });
+    });
+
+    const double buildSecs=bestOf(1, [&]{ ColumnSnapshot::build(db, pool).save(out); });
+    ColumnSnapshot snap;
+    const double loadSecs=bestOf(1, [&]{ snap=ColumnSnapshot::load(out); });
+
+    SalaryGroups scalar, simd;
+    const double scalarSecs=bestOf(5, [&]{ scalar=snap.aggregate(cf, by, false); });
+    const double simdSecs=bestOf(5, [&]{ simd=snap.aggregate(cf, by, true); });
+
+    printGroups(simd);
+    const double gib=static_cast<double>(snap.bytes()-snap.rows()*sizeof(std::uint32_t))/(1<<30);
+    std::cout << "snapshot: " << snap.rows() << " rows, " << snap.bytes() << " column bytes, built in " << buildSecs
+              << " s, loaded in " << loadSecs << " s\n";
+    std::cout << "row scan: " << rowSecs << " s\n";
+    std::cout << "columns scalar: " << scalarSecs << " s (" << gib/scalarSecs << " GiB/s)\n";
+    std::cout << "columns " << (ColumnSnapshot::simdAvailable()? "avx2" : "scalar (no avx2)") << ": " << simdSecs
+              << " s (" << gib/simdSecs << " GiB/s)\n";
+    const bool same=sameGroups(rows, scalar) && sameGroups(rows, simd);
+    if(!same) std::cout << "MISMATCH against the row scan\n";
+    return same? 0 : 1;
+}
+
+int pack(const std::string& file, int argc, char** argv){
+    GroupBy by=GroupBy::City;
+    unsigned int threads=std::thread::hardware_concurrency();
+    std::string out=file+".ppak";
+    RowFilter filter;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--group") by=parseGroup(val);
+        else if(key=="--threads") threads=std::stoul(val);
+        else if(key=="--out") out=val;
+        else if(!filter.parse(key, val)){
+            usage();
+            return 1;
+        }
+    }
+
+    FileMang<Person> db(file);
+    ThreadPool pool(threads? threads : 1);
+    PackStats stats;
+    const double packSecs=bestOf(1, [&]{ stats=PackedFile::pack(db, out); });
+    const PackedFile packedFile(out);
+
+    SalaryGroups rows, packedRows;
+    const double rowSecs=bestOf(3, [&]{
+        rows=aggregateSalary(db, pool, by, [&](const PersonView& r){
+            return filter.accept(r.city(), r.year(), r.salary());
+        });
+    });
+    const double packedSecs=bestOf(3, [&]{
+        packedRows=aggregateSalary(packedFile, pool, by, [&](const PackedRecord& r){
+            return filter.accept(r.city(), r.year(), r.salary());
+        });
+    });
+
+    std::mt19937_64 rng(5);
+    const KeyGenerator keys(KeyDistribution::Uniform, db.count()? db.count()*2 : 1);
+    std::size_t mismatched=0, found=0;
+    Person expected;
+    PackedRecord r;
+    const double lookupSecs=bestOf(1, [&]{
+        for(int i=0; i<100000; ++i){
+            const long sin=sinOf(keys(rng));
+            const bool inRows=db.get(sin, expected);
+            const bool inPacked=packedFile.find(sin, r);
+            found+=inPacked;
+            if(inRows!=inPacked || (inPacked && (r.sin()!=expected.getSIN() || r.city()!=expected.getCity()
+                                                  || r.year()!=expected.getYear() || r.salary()!=expected.getSalary()))){
+                ++mismatched;
+            }
+        }
+    });
+
+    printGroups(packedRows);
+    std::cout << "packed: " << stats.records << " records in " << stats.pages << " pages, " << stats.cities
+              << " cities, " << stats.sourceBytes << " -> " << stats.packedBytes << " bytes ("
+              << (stats.packedBytes? static_cast<double>(stats.sourceBytes)/stats.packedBytes : 0) << "x) in "
+              << packSecs << " s\n";
+    std::cout << "row scan: " << rowSecs << " s, packed scan: " << packedSecs << " s\n";
+    std::cout << "100000 point lookups (" << found << " found) checked against get() in " << lookupSecs << " s\n";
+    const bool same=sameGroups(rows, packedRows) && !mismatched;
+    if(!same) std::cout << "MISMATCH against the row file (" << mismatched << " lookups)\n";
+    return same? 0 : 1;
+}
+
+int views(const std::string& file, int argc, char** argv){
+    std::uint64_t ops=1000000;
+    std::uint64_t perTxn=64;
+    std::size_t cachePages=4096;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--ops") ops=std::stoull(val);
+        else if(key=="--per-txn") perTxn=std::max<std::uint64_t>(1, std::stoull(val));
+        else if(key=="--cache-pages") cachePages=std::stoull(val);
+        else{
+            usage();
+            return 1;
+        }
+    }
+
+    FileMang<Person> db(file, true, std::chrono::seconds(1), cachePages);
+    const KeyGenerator keys(KeyDistribution::Zipfian, db.count()? db.count() : 1);
+    std::mt19937_64 rng(3);
+    std::vector<long> sins(ops);
+    for(auto& sin : sins) sin=sinOf(keys(rng));
+
+    long long copySum=0, viewSum=0;
+    std::size_t mismatched=0, pinned=0, copied=0;
+    Person rec;
+    const double copySecs=bestOf(1, [&]{
+        for(const long sin : sins){
+            if(db.get(sin, rec)) copySum+=rec.getSalary()+rec.getCity().size();
+        }
+    });
+    const double viewSecs=bestOf(1, [&]{
+        for(std::uint64_t first=0; first<ops; first+=perTxn){
+            FileMang<Person>::ReadTxn txn=db.beginRead();
+            PersonView v;
+            for(std::uint64_t i=first; i<std::min(ops, first+perTxn); ++i){
+                if(txn.get(sins[i], v)) viewSum+=v.salary()+v.city().size();
+            }
+            pinned+=txn.pinned();
+            copied+=txn.copied();
+        }
+    });
+    for(std::uint64_t i=0; i<ops && i<10000; ++i){
+        db.withView<PersonView>(sins[i], [&](const PersonView& v){
+            db.get(sins[i], rec);
+            if(v.sin()!=rec.getSIN() || v.city()!=rec.getCity() || v.year()!=rec.getYear() || v.salary()!=rec.getSalary()) ++mismatched;
+        });
+    }
+
+    std::cout << "get (copy into Person): " << ops << " reads in " << copySecs << " s, "
+              << (ops? copySecs*1e9/ops : 0) << " ns/read\n";
+    std::cout << "ReadTxn views (" << perTxn << " per txn): " << ops << " reads in " << viewSecs << " s, "
+              << (ops? viewSecs*1e9/ops : 0) << " ns/read, " << pinned << " page pins, " << copied << " copies\n";
+    const bool same= copySum==viewSum && !mismatched;
+    if(!same) std::cout << "MISMATCH between views and get()\n";
+    return same? 0 : 1;
+}
+
+int shards(const std::string& file, int argc, char** argv){
+    std::size_t count=4;
+    std::string base=file+".shard";
+    std::uint64_t ops=200000;
+    std::size_t batch=1024;
+    unsigned int threads=std::thread::hardware_concurrency();
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--shards") count=std::stoull(val);
+        else if(key=="--out") base=val;
+        else if(key=="--ops") ops=std::stoull(val);
+        else if(key=="--batch") batch=std::max<std::size_t>(1, std::stoull(val));
+        else if(key=="--threads") threads=std::stoul(val);
+        else{
+            usage();
+            return 1;
+        }
+    }
+    if(!count) throw std::invalid_argument("need at least one shard");
+
+    FileMang<Person> db(file);
+    ThreadPool pool(threads? threads : 1);
+    std::vector<Person> live=parallelScan<std::vector<Person>>(db, pool,
+        [](std::vector<Person>& acc, const PersonView& r){
+            if(r.isRemoved()) return;
+            const std::string sin(r.data(), strnlen(r.data(), PersonLayout::sinLen));
+            acc.emplace_back(sin.c_str(), std::string(r.fname()).c_str(), std::string(r.lname()).c_str(),
+                             std::string(r.city()).c_str(), r.year(), r.salary());
+        },
+        [](std::vector<Person>& into, std::vector<Person>&& part){
+            into.insert(into.end(), part.begin(), part.end());
+        });
+
+    for(const std::string& path : ShardedFileMang<Person>::shardPaths(base, count)){
+        for(const char* suffix : {"", ".wal", ".shard", ".sin.bloom"}) std::remove((path+suffix).c_str());
+    }
+    ShardedFileMang<Person> sharded(base, count);
+    std::size_t added=0;
+    const double loadSecs=bestOf(1, [&]{ added=sharded.insertMany(live); });
+
+    const KeyGenerator keys(KeyDistribution::Uniform, db.count()? db.count()*2 : 1);
+    std::mt19937_64 rng(7);
+    std::vector<long> sins(ops);
+    for(auto& sin : sins) sin=sinOf(keys(rng));
+
+    std::vector<Person> expected(ops);
+    std::vector<bool> inSource(ops);
+    const double singleSecs=bestOf(1, [&]{
+        for(std::uint64_t i=0; i<ops; ++i) inSource[i]=db.get(sins[i], expected[i]);
+    });
+    std::size_t mismatched=0;
+    const double shardedSecs=bestOf(1, [&]{
+        for(std::uint64_t first=0; first<ops; first+=batch){
+            const std::uint64_t last=std::min<std::uint64_t>(ops, first+batch);
+            const std::vector<long> wave(sins.begin()+first, sins.begin()+last);
+            std::vector<Person> recs;
+            const std::vector<bool> found=sharded.getMany(wave, recs);
+            for(std::size_t i=0; i<wave.size(); ++i){
+                if(found[i]!=inSource[first+i] || (found[i] && recs[i].getSalary()!=expected[first+i].getSalary())) ++mismatched;
+            }
+        }
+    });
+
+    SalaryGroups rows, shardedRows;
+    const double rowSecs=bestOf(3, [&]{
+        rows=aggregateSalary(db, pool, GroupBy::City, [](const PersonView&){ return true; });
+    });
+    const double shardedScanSecs=bestOf(3, [&]{
+        shardedRows=aggregateSalary(sharded, pool, GroupBy::City, [](const PersonView&){ return true; });
+    });
+
+    std::cout << "sharded " << added << " records over " << count << " files in " << loadSecs << " s:";
+    for(std::size_t i=0; i<count; ++i) std::cout << " " << sharded.shard(i).count();
+    std::cout << "\n";
+    std::cout << "single file get: " << ops << " reads in " << singleSecs << " s: "
+              << static_cast<std::uint64_t>(ops/singleSecs) << " ops/s\n";
+    std::cout << "getMany (batch " << batch << "): " << ops << " reads in " << shardedSecs << " s: "
+              << static_cast<std::uint64_t>(ops/shardedSecs) << " ops/s\n";
+    std::cout << "scan by city: single " << rowSecs << " s, sharded " << shardedScanSecs << " s\n";
+    const bool same= added==live.size() && sharded.count()==db.count() && !mismatched && sameGroups(rows, shardedRows);
+    if(!same) std::cout << "MISMATCH against the single file (" << mismatched << " lookups)\n";
+    return same? 0 : 1;
+}
+
+void printSpace(const char* when, const SpaceStats& s){
+    std::cout << when << ": file " << s.fileBytes << " bytes, live " << s.liveBytes << " bytes, " << s.holes << " holes\n";
+}
+
+int compact(const std::string& file, int argc, char** argv){
+    double erase=0;
+    std::uint64_t rate=0;
+    int threads=1;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--erase") erase=std::stod(val);
+        else if(key=="--rate") rate=std::stoull(val);
+        else if(key=="--threads") threads=std::stoi(val);
+        else{
+            usage();
+            return 1;
+        }
+    }
+
+    FileMang<Person> db(file);
+    const std::uint64_t loaded=db.count();
+    std::mt19937_64 rng(7);
+    std::vector<long> live;
+    for(std::uint64_t i=0; i<loaded; ++i){
+        if(erase>0 && std::uniform_real_distribution<double>(0, 1)(rng)<erase) db.erase(sinOf(i));
+        else live.push_back(sinOf(i));
+    }
+    printSpace("before", db.space());
+
+    const IoStats before=db.ioStats();
+    const auto start=std::chrono::steady_clock::now();
+    std::vector<LatencyRecorder> latencies(threads);
+    if(rate){
+        std::atomic<bool> done{false};
+        std::vector<std::thread> readers;
+        for(int t=0; t<threads; ++t){
+            readers.emplace_back([&, t]{
+                std::mt19937_64 r(t+1);
+                Person rec;
+                while(!done.load(std::memory_order_relaxed) && !live.empty()){
+                    const std::uint64_t begin=nowNs();
+                    db.get(live[r()%live.size()], rec);
+                    latencies[t].record(nowNs()-begin);
+                }
+            });
+        }
+        db.startCompaction(rate<<10, 0);
+        while(db.space().holes) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        db.stopCompaction();
+        done=true;
+        for(auto& th : readers) th.join();
+    }else{
+        db.compact();
+    }
+    const double secs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    const IoStats after=db.ioStats();
+    printSpace("after", db.space());
+
+    LatencyRecorder all;
+    for(auto& l : latencies) all.merge(l);
+    std::cout << "compaction: " << after.relocated-before.relocated << " records relocated, "
+              << after.trimmedBytes-before.trimmedBytes << " bytes trimmed in " << secs << " s";
+    if(all.count()) std::cout << "; concurrent get p50 " << all.percentile(0.5) << " ns, p99 " << all.percentile(0.99) << " ns";
+    std::cout << "\n";
+
+    std::size_t missing=0;
+    Person rec;
+    for(const long sin : live){
+        if(!db.get(sin, rec) || rec.getSIN()!=sin) ++missing;
+    }
+    if(missing || db.count()!=live.size()) std::cout << "LOST " << missing << " records\n";
+    return missing? 1 : 0;
+}
+
+// Asks the kernel to drop the file from the page cache so reads reach the
+// device; advisory, and a no-op for dirty pages.
+void dropCache(const std::string& file){
+    const int fd=::open(file.c_str(), O_RDONLY);
+    if(fd<0) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+int asyncGet(const std::string& file, int argc, char** argv){
+    std::uint64_t ops=100000;
+    unsigned int depth=64;
+    std::size_t cachePages=64;
+    AsyncBackend backend=AsyncBackend::Auto;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--ops") ops=std::stoull(val);
+        else if(key=="--depth") depth=static_cast<unsigned int>(std::stoul(val));
+        else if(key=="--cache-pages") cachePages=std::stoull(val);
+        else if(key=="--backend"){
+            if(val=="auto") backend=AsyncBackend::Auto;
+            else if(val=="uring") backend=AsyncBackend::Uring;
+            else if(val=="threads") backend=AsyncBackend::Threads;
+            else throw std::invalid_argument("unknown backend "+val);
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(!depth) throw std::invalid_argument("depth must be positive");
+
+    FileMang<Person> db(file, true, std::chrono::seconds(1), cachePages);
+    db.useAsyncBackend(backend, depth);
+    const std::uint64_t loaded=db.count();
+    const KeyGenerator keys(KeyDistribution::Uniform, loaded? loaded : 1);
+    std::mt19937_64 rng(11);
+    std::vector<long> sins(ops);
+    for(auto& sin : sins) sin=sinOf(keys(rng));
+
+    dropCache(file);
+    std::vector<Person> expected(ops);
+    auto start=std::chrono::steady_clock::now();
+    for(std::uint64_t i=0; i<ops; ++i) db.get(sins[i], expected[i]);
+    const double syncSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    dropCache(file);
+    const IoStats before=db.ioStats();
+    const AsyncIoStats aioBefore=db.asyncStats();
+    std::size_t mismatched=0;
+    start=std::chrono::steady_clock::now();
+    for(std::uint64_t first=0; first<ops; first+=depth){
+        const std::vector<long> wave(sins.begin()+first, sins.begin()+std::min<std::uint64_t>(ops, first+depth));
+        std::vector<Person> recs;
+        std::vector<std::future<bool>> done=db.getAsync(wave, recs);
+        for(std::size_t i=0; i<done.size(); ++i){
+            if(done[i].get() && recs[i].getSIN()!=expected[first+i].getSIN()) ++mismatched;
+        }
+    }
+    const double asyncSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    const IoStats after=db.ioStats();
+    const AsyncIoStats aio=db.asyncStats();
+
+    std::cout << "sync get: " << ops << " reads in " << syncSecs << " s: " << static_cast<std::uint64_t>(ops/syncSecs) << " ops/s\n";
+    std::cout << "getAsync (" << db.asyncBackend() << ", depth " << depth << "): " << ops << " reads in " << asyncSecs
+              << " s: " << static_cast<std::uint64_t>(ops/asyncSecs) << " ops/s\n";
+    std::cout << "device reads: " << after.asyncReads-before.asyncReads << " (" << after.asyncRetries-before.asyncRetries
+              << " retried), " << aio.batches-aioBefore.batches << " batches, " << aio.syscalls-aioBefore.syscalls << " syscalls\n";
+    if(mismatched) std::cout << "MISMATCH in " << mismatched << " records\n";
+    return mismatched? 1 : 0;
+}
+
+#ifdef COROUTINES
+// One of many coroutine readers: takes indexes off work until it is closed and
+// drained, awaiting each record; the last one out fulfils finished.
+Task<void> coroReader(AsyncQueue<std::uint64_t>& work, AsyncStore<Person>& store, const std::vector<long>& sins,
+                      const std::vector<Person>& expected, std::atomic<std::size_t>& mismatched,
+                      std::atomic<std::size_t>& running, std::promise<void>& finished){
+    while(std::optional<std::uint64_t> i=co_await work.pop()){
+        const std::optional<Person> rec=co_await store.get(sins[*i]);
+        if(rec && rec->getSIN()!=expected[*i].getSIN()) mismatched.fetch_add(1, std::memory_order_relaxed);
+    }
+    if(running.fetch_sub(1, std::memory_order_acq_rel)==1) finished.set_value();
+}
+
+Task<void> coroFeeder(AsyncQueue<std::uint64_t>& work, const std::uint64_t ops){
+    for(std::uint64_t i=0; i<ops; ++i){
+        if(!co_await work.push(i)) break;
+    }
+    work.close();
+}
+
+int coroGet(const std::string& file, int argc, char** argv){
+    std::uint64_t ops=100000;
+    std::size_t waiters=4096;
+    unsigned int threads=2;
+    std::size_t cachePages=64;
+    AsyncBackend backend=AsyncBackend::Auto;
+    for(int i=3; i<argc; ++i){
+        const std::string arg{argv[i]};
+        const std::size_t eq=arg.find('=');
+        const std::string key=arg.substr(0, eq);
+        const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+        if(key=="--ops") ops=std::stoull(val);
+        else if(key=="--waiters") waiters=std::stoull(val);
+        else if(key=="--threads") threads=static_cast<unsigned int>(std::stoul(val));
+        else if(key=="--cache-pages") cachePages=std::stoull(val);
+        else if(key=="--backend"){
+            if(val=="auto") backend=AsyncBackend::Auto;
+            else if(val=="uring") backend=AsyncBackend::Uring;
+            else if(val=="threads") backend=AsyncBackend::Threads;
+            else throw std::invalid_argument("unknown backend "+val);
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(!waiters || !threads) throw std::invalid_argument("waiters and threads must be positive");
+
+    FileMang<Person> db(file, true, std::chrono::seconds(1), cachePages);
+    db.useAsyncBackend(backend);
+    const std::uint64_t loaded=db.count();
+    const KeyGenerator keys(KeyDistribution::Uniform, loaded? loaded : 1);
+    std::mt19937_64 rng(11);
+    std::vector<long> sins(ops);
+    for(auto& sin : sins) sin=sinOf(keys(rng));
+
+    dropCache(file);
+    std::vector<Person> expected(ops);
+    auto start=std::chrono::steady_clock::now();
+    for(std::uint64_t i=0; i<ops; ++i) db.get(sins[i], expected[i]);
+    const double syncSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    dropCache(file);
+    std::atomic<std::size_t> mismatched{0};
+    std::atomic<std::size_t> running{waiters};
+    std::promise<void> finished;
+    start=std::chrono::steady_clock::now();
+    {
+        CoroExecutor ex(threads);
+        AsyncStore<Person> store(db, ex);
+        AsyncQueue<std::uint64_t> work(ex, waiters);
+        for(std::size_t i=0; i<waiters; ++i) spawn(ex, coroReader(work, store, sins, expected, mismatched, running, finished));
+        spawn(ex, coroFeeder(work, ops));
+        finished.get_future().wait();
+    }
+    const double coroSecs=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    std::cout << "sync get: " << ops << " reads in " << syncSecs << " s: " << static_cast<std::uint64_t>(ops/syncSecs) << " ops/s\n";
+    std::cout << "co_await get (" << db.asyncBackend() << ", " << waiters << " coroutines on " << threads << " threads): " << ops
+              << " reads in " << coroSecs << " s: " << static_cast<std::uint64_t>(ops/coroSecs) << " ops/s\n";
+    if(mismatched) std::cout << "MISMATCH in " << mismatched << " records\n";
+    return mismatched? 1 : 0;
+}
+#endif
+
+int main(int argc, char** argv){
+    if(argc<3){
+        usage();
+        return 1;
+    }
+    const std::string cmd{argv[1]};
+    try{
+        if(cmd=="generate"){
+            if(argc<4){
+                usage();
+                return 1;
+            }
+            return generate(argv[2], std::stoull(argv[3]), argc>4? std::stoull(argv[4]) : 1);
+        }
+        if(cmd=="run"){
+            RunConfig cfg;
+            cfg.file=argv[2];
+            ycsbMix('A', cfg.mix);
+            for(int i=3; i<argc; ++i){
+                const std::string arg{argv[i]};
+                const std::size_t eq=arg.find('=');
+                const std::string key=arg.substr(0, eq);
+                const std::string val= eq==std::string::npos? "" : arg.substr(eq+1);
+                if(key=="--workload"){
+                    if(val.size()!=1 || !ycsbMix(val[0], cfg.mix)) throw std::invalid_argument("unknown workload "+val);
+                }else if(key=="--ops"){
+                    cfg.ops=std::stoull(val);
+                }else if(key=="--threads"){
+                    cfg.threads=std::stoi(val);
+                    if(cfg.threads<1) throw std::invalid_argument("threads must be positive");
+                }else if(key=="--dist"){
+                    if(!parseDistribution(val, cfg.dist)) throw std::invalid_argument("unknown distribution "+val);
+                }else if(key=="--format"){
+                    cfg.json= val=="json";
+                }else if(key=="--no-wal"){
+                    cfg.logged=false;
+                }else if(key=="--indexes"){
+                    cfg.indexed=true;
+                }else if(key=="--bloom"){
+                    cfg.bloomBits= val.empty()? 10 : std::stod(val);
+                    if(cfg.bloomBits<=0) throw std::invalid_argument("bloom bits per key must be positive");
+                }else if(key=="--compact"){
+                    cfg.compactRate=std::stoull(val);
+                }else if(key=="--cache-pages"){
+                    cfg.cachePages=std::stoull(val);
+                    if(!cfg.cachePages) throw std::invalid_argument("cache-pages must be positive");
+                }else{
+                    usage();
+                    return 1;
+                }
+            }
+            return run(cfg);
+        }
+        if(cmd=="query") return query(argv[2], argc, argv);
+        if(cmd=="scan") return scan(argv[2], argc, argv);
+        if(cmd=="columns") return columnar(argv[2], argc, argv);
+        if(cmd=="compact") return compact(argv[2], argc, argv);
+        if(cmd=="pack") return pack(argv[2], argc, argv);
+        if(cmd=="views") return views(argv[2], argc, argv);
+        if(cmd=="shards") return shards(argv[2], argc, argv);
+        if(cmd=="async") return asyncGet(argv[2], argc, argv);
+#ifdef COROUTINES
+        if(cmd=="coro") return coroGet(argv[2], argc, argv);
+#endif
+    }catch(std::exception& ex){
+        std::cerr << "Exception: " << ex.what() << "\n";
+        return 1;
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,332 @@
+#ifndef _ASYNCIO_H_
+#define _ASYNCIO_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ASYNCIO_HAVE_URING 1
+#endif
+
+#include "ThreadPool.hpp"
+
+class AsyncIoException: public std::exception{
+    std::string msg;
+public:
+    AsyncIoException(std::string message="Asynchronous I/O failure"): msg(std::move(message)) {}
+    virtual const char* what() const noexcept override { return msg.c_str();}
+};
+
+// done receives the bytes transferred (short only at end of file) or -errno,
+// on whatever thread reaped the completion.
+struct IoRequest{
+    int fd=-1;
+    char* buf=nullptr;
+    std::size_t len=0;
+    off_t off=0;
+    bool write=false;
+    std::function<void(long)> done;
+};
+
+struct AsyncIoStats{
+    std::uint64_t submitted=0;
+    std::uint64_t completed=0;
+    std::uint64_t batches=0;
+    std::uint64_t syscalls=0;
+};
+
+enum class AsyncBackend{ Auto, Uring, Threads };
+
+inline long transferFully(const IoRequest& r, std::size_t done=0){
+    while(done<r.len){
+        const ssize_t n= r.write? ::pwrite(r.fd, r.buf+done, r.len-done, r.off+static_cast<off_t>(done))
+                                : ::pread(r.fd, r.buf+done, r.len-done, r.off+static_cast<off_t>(done));
+        if(n<0 && errno==EINTR) continue;
+        if(n<0) return -errno;
+        if(n==0) break;
+        done+=static_cast<std::size_t>(n);
+    }
+    return static_cast<long>(done);
+}
+
+class AsyncIo{
+protected:
+    std::atomic<std::uint64_t> submitted{0}, completed{0}, batches{0}, syscalls{0};
+
+public:
+    virtual ~AsyncIo()=default;
+
+    virtual const char* name() const=0;
+
+    // Queues every request of the batch, moving them out; returns without
+    // waiting for any of them.
+    virtual void submit(std::vector<IoRequest>& batch)=0;
+
+    AsyncIoStats stats() const{
+        AsyncIoStats s;
+        s.submitted=submitted.load(std::memory_order_relaxed);
+        s.completed=completed.load(std::memory_order_relaxed);
+        s.batches=batches.load(std::memory_order_relaxed);
+        s.syscalls=syscalls.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+// Portable backend: each request is a blocking pread/pwrite on a pool worker,
+// so the queue depth seen by the device is the number of workers.
+class ThreadedIo: public AsyncIo{
+    ThreadPool workers;
+
+public:
+    explicit ThreadedIo(const unsigned int threads): workers{threads} {}
+
+    const char* name() const override{ return "threads"; }
+
+    void submit(std::vector<IoRequest>& batch) override{
+        batches.fetch_add(1, std::memory_order_relaxed);
+        for(IoRequest& r : batch){
+            submitted.fetch_add(1, std::memory_order_relaxed);
+            workers.submit([this, req=std::move(r)]{
+                const long res=transferFully(req);
+                syscalls.fetch_add(1, std::memory_order_relaxed);
+                completed.fetch_add(1, std::memory_order_relaxed);
+                req.done(res);
+            });
+        }
+        batch.clear();
+    }
+};
+
+#ifdef ASYNCIO_HAVE_URING
+
+// io_uring driven through the raw syscalls, without liburing. A batch is
+// written into the submission ring and handed to the kernel with one
+// io_uring_enter; a reaper thread waits on the completion ring. In-flight
+// requests are capped at the SQ size, and the CQ is twice that, so the
+// completion ring cannot overflow.
+class UringIo: public AsyncIo{
+    struct Pending{
+        IoRequest req;
+    };
+
+    int ring=-1;
+    unsigned int entries=0;
+    void* sqMap=MAP_FAILED;
+    void* cqMap=MAP_FAILED;
+    std::size_t sqMapLen=0, cqMapLen=0;
+    io_uring_sqe* sqes=static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqesLen=0;
+    unsigned *sqTail=nullptr, *sqMask=nullptr, *sqArray=nullptr;
+    unsigned *cqHead=nullptr, *cqTail=nullptr, *cqMask=nullptr;
+    io_uring_cqe* cqes=nullptr;
+
+    std::mutex mtx;
+    std::condition_variable room;
+    unsigned int inflight=0;
+    std::thread reaper;
+
+    static int enter(const int fd, const unsigned int toSubmit, const unsigned int minComplete, const unsigned int flags){
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    void unmap(){
+        if(sqes!=MAP_FAILED) ::munmap(sqes, sqesLen);
+        if(cqMap!=MAP_FAILED && cqMap!=sqMap) ::munmap(cqMap, cqMapLen);
+        if(sqMap!=MAP_FAILED) ::munmap(sqMap, sqMapLen);
+        if(ring>=0) ::close(ring);
+    }
+
+    // Fills one SQE per queued item and tells the kernel about all of them;
+    // called with mtx held.
+    void push(const unsigned int count, const std::function<void(io_uring_sqe&, unsigned int)>& fill){
+        const unsigned int tail=*sqTail;
+        for(unsigned int i=0; i<count; ++i){
+            const unsigned int idx=(tail+i)&*sqMask;
+            memset(&sqes[idx], 0, sizeof(io_uring_sqe));
+            fill(sqes[idx], i);
+            sqArray[idx]=idx;
+        }
+        __atomic_store_n(sqTail, tail+count, __ATOMIC_RELEASE);
+        unsigned int sent=0;
+        while(sent<count){
+            const int rc=enter(ring, count-sent, 0, 0);
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+            if(rc<0 && (errno==EINTR || errno==EAGAIN || errno==EBUSY)) continue;
+            if(rc<0) throw AsyncIoException(std::string("io_uring_enter: ")+strerror(errno));
+            sent+=static_cast<unsigned int>(rc);
+        }
+    }
+
+    void finish(Pending* p, long res){
+        // A short transfer or an opcode the kernel lacks is finished inline.
+        if(res==-EINVAL || res==-EOPNOTSUPP) res=transferFully(p->req);
+        else if(res>0 && static_cast<std::size_t>(res)<p->req.len) res=transferFully(p->req, static_cast<std::size_t>(res));
+        completed.fetch_add(1, std::memory_order_relaxed);
+        try{
+            p->req.done(res);
+        }catch(std::exception& ex){
+            std::cerr << "Exception in I/O completion: " << ex.what() << "\n";
+        }
+        delete p;
+    }
+
+    void reap(){
+        while(true){
+            const unsigned int head=*cqHead;
+            const unsigned int tail=__atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            if(head==tail){
+                if(enter(ring, 0, 1, IORING_ENTER_GETEVENTS)<0 && errno!=EINTR){
+                    std::cerr << "io_uring_enter: " << strerror(errno) << "\n";
+                }
+                continue;
+            }
+            bool stop=false;
+            unsigned int done=0;
+            for(unsigned int h=head; h!=tail; ++h){
+                const io_uring_cqe& c=cqes[h&*cqMask];
+                Pending* p=reinterpret_cast<Pending*>(static_cast<std::uintptr_t>(c.user_data));
+                const long res=c.res;
+                __atomic_store_n(cqHead, h+1, __ATOMIC_RELEASE);
+                if(!p){
+                    stop=true;
+                    continue;
+                }
+                finish(p, res);
+                ++done;
+            }
+            if(done){
+                std::lock_guard<std::mutex> lock{mtx};
+                inflight-=done;
+                room.notify_all();
+            }
+            if(stop) return;
+        }
+    }
+
+public:
+    explicit UringIo(const unsigned int depth){
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags=IORING_SETUP_CQSIZE;
+        params.cq_entries=2*depth;
+        ring=static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+        if(ring<0) throw AsyncIoException(std::string("io_uring_setup: ")+strerror(errno));
+        entries=params.sq_entries;
+
+        sqMapLen=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+        cqMapLen=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+        const bool single=params.features & IORING_FEAT_SINGLE_MMAP;
+        if(single) sqMapLen=cqMapLen=std::max(sqMapLen, cqMapLen);
+        sqMap=::mmap(nullptr, sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        if(sqMap!=MAP_FAILED){
+            cqMap= single? sqMap : ::mmap(nullptr, cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+        }
+        sqesLen=params.sq_entries*sizeof(io_uring_sqe);
+        if(cqMap!=MAP_FAILED){
+            sqes=static_cast<io_uring_sqe*>(::mmap(nullptr, sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES));
+        }
+        if(sqes==MAP_FAILED){
+            unmap();
+            throw AsyncIoException("Unable to map io_uring rings");
+        }
+
+        char* sq=static_cast<char*>(sqMap);
+        char* cq=static_cast<char*>(cqMap);
+        sqTail=reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+        sqMask=reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+        sqArray=reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+        cqHead=reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+        cqTail=reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+        cqMask=reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+        cqes=reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+
+        reaper=std::thread(&UringIo::reap, this);
+    }
+
+    // Waits for everything in flight, then wakes the reaper with a NOP whose
+    // user_data is null.
+    ~UringIo(){
+        {
+            std::unique_lock<std::mutex> lock{mtx};
+            room.wait(lock, [this]{ return inflight==0; });
+            try{
+                push(1, [](io_uring_sqe& sqe, unsigned int){
+                    sqe.opcode=IORING_OP_NOP;
+                    sqe.user_data=0;
+                });
+            }catch(std::exception& ex){
+                std::cerr << "Exception in destruction: " << ex.what() << "\n";
+            }
+        }
+        if(reaper.joinable()) reaper.join();
+        unmap();
+    }
+
+    UringIo(const UringIo&)=delete;
+    UringIo& operator=(const UringIo&)=delete;
+
+    const char* name() const override{ return "io_uring"; }
+
+    void submit(std::vector<IoRequest>& batch) override{
+        batches.fetch_add(1, std::memory_order_relaxed);
+        std::size_t next=0;
+        while(next<batch.size()){
+            std::unique_lock<std::mutex> lock{mtx};
+            room.wait(lock, [this]{ return inflight<entries; });
+            const unsigned int count=static_cast<unsigned int>(std::min<std::size_t>(entries-inflight, batch.size()-next));
+            std::vector<Pending*> pending(count);
+            for(unsigned int i=0; i<count; ++i) pending[i]=new Pending{std::move(batch[next+i])};
+            push(count, [&pending](io_uring_sqe& sqe, const unsigned int i){
+                const IoRequest& r=pending[i]->req;
+                sqe.opcode= r.write? IORING_OP_WRITE : IORING_OP_READ;
+                sqe.fd=r.fd;
+                sqe.addr=reinterpret_cast<std::uintptr_t>(r.buf);
+                sqe.len=static_cast<unsigned int>(r.len);
+                sqe.off=static_cast<std::uint64_t>(r.off);
+                sqe.user_data=reinterpret_cast<std::uintptr_t>(pending[i]);
+            });
+            inflight+=count;
+            submitted.fetch_add(count, std::memory_order_relaxed);
+            next+=count;
+        }
+        batch.clear();
+    }
+};
+
+#endif
+
+// Auto prefers io_uring and falls back to threads when the kernel refuses it
+// (too old, disabled by sysctl, or blocked by a seccomp profile).
+inline std::unique_ptr<AsyncIo> makeAsyncIo(const AsyncBackend kind=AsyncBackend::Auto, const unsigned int depth=256,
+                                            const unsigned int threads=4){
+#ifdef ASYNCIO_HAVE_URING
+    if(kind!=AsyncBackend::Threads){
+        try{
+            return std::unique_ptr<AsyncIo>(new UringIo(depth));
+        }catch(AsyncIoException&){
+            if(kind==AsyncBackend::Uring) throw;
+        }
+    }
+#else
+    if(kind==AsyncBackend::Uring) throw AsyncIoException("io_uring is not available on this platform");
+#endif
+    return std::unique_ptr<AsyncIo>(new ThreadedIo(threads));
+}
+
+#endif
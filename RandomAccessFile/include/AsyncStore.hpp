@@ -0,0 +1,75 @@
+#ifndef _ASYNCSTORE_H_
+#define _ASYNCSTORE_H_
+
+#include "FileMang.hpp"
+#include "Coro.hpp"
+
+#ifdef COROUTINES
+
+#include <atomic>
+#include <exception>
+#include <optional>
+
+// co_await store.get(sin) for coroutines: the read goes through getThen, so a
+// record already in the log or the page cache comes back without suspending,
+// and otherwise the coroutine sleeps until the I/O completes and is resumed on
+// the executor, not on the I/O thread.
+template<typename F>
+class AsyncStore{
+    FileMang<F>& db;
+    CoroExecutor& ex;
+
+public:
+    AsyncStore(FileMang<F>& file, CoroExecutor& executor): db{file}, ex{executor} {}
+
+    // Gives std::optional<F>, empty when the SIN is not there; rethrows what
+    // get() would have thrown.
+    auto get(const long sin){
+        struct Awaiter{
+            FileMang<F>& db;
+            CoroExecutor& ex;
+            long sin;
+            F rec;
+            bool found;
+            std::exception_ptr err;
+            std::coroutine_handle<> h;
+            // Whichever of await_suspend and the completion gets here second
+            // resumes the coroutine.
+            std::atomic<bool> met;
+
+            struct Done{
+                Awaiter* a;
+                void set_value(const bool v){
+                    a->found=v;
+                    a->finish();
+                }
+                void set_exception(const std::exception_ptr e){
+                    a->err=e;
+                    a->finish();
+                }
+            };
+
+            void finish(){
+                if(met.exchange(true, std::memory_order_acq_rel)) ex.post(h);
+            }
+
+            bool await_ready() const noexcept{ return false; }
+
+            bool await_suspend(const std::coroutine_handle<> handle){
+                h=handle;
+                if(db.getThen(sin, rec, Done{this})) return false;
+                return !met.exchange(true, std::memory_order_acq_rel);
+            }
+
+            std::optional<F> await_resume(){
+                if(err) std::rethrow_exception(err);
+                return found? std::optional<F>(std::move(rec)) : std::nullopt;
+            }
+        };
+        return Awaiter{db, ex, sin, F(), false, nullptr, nullptr, {false}};
+    }
+};
+
+#endif
+
+#endif
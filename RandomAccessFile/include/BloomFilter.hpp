@@ -0,0 +1,135 @@
+#ifndef _BLOOMFILTER_H_
+#define _BLOOMFILTER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BLOOM_AVX2 1
+#include <immintrin.h>
+#endif
+
+// Split-block Bloom filter: a key hashes to one 32-byte block and sets one bit
+// in each of its eight 32-bit words, so a probe touches one aligned half cache
+// line and the eight word tests are a single AVX2 test. Keys cannot be removed; the
+// owner counts removals and rebuilds once they make the filter too loose.
+class BlockedBloomFilter{
+    struct alignas(32) Block{
+        std::uint32_t words[8];
+    };
+
+    static constexpr std::uint32_t salt[8]={0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    std::vector<Block> blocks;
+    std::uint64_t keys=0;
+    std::uint64_t removed=0;
+    std::uint64_t capacity=0;
+    double bitsPerKey=10;
+
+    static std::uint64_t mix(std::uint64_t h){
+        h^=h>>33;
+        h*=0xff51afd7ed558ccdULL;
+        h^=h>>33;
+        h*=0xc4ceb9fe1a85ec53ULL;
+        h^=h>>33;
+        return h;
+    }
+
+    std::size_t blockOf(const std::uint64_t h) const{
+        return static_cast<std::size_t>(((h>>32)*blocks.size())>>32);
+    }
+
+    static bool testScalar(const Block& b, const std::uint32_t h){
+        for(int i=0; i<8; ++i){
+            if(!(b.words[i] & (1U<<((h*salt[i])>>27)))) return false;
+        }
+        return true;
+    }
+
+#ifdef BLOOM_AVX2
+    static bool haveAvx2(){
+        static const bool avx2=__builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+    __attribute__((target("avx2")))
+    static bool testAvx2(const Block& b, const std::uint32_t h){
+        const __m256i salts=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(salt));
+        const __m256i bits=_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(h)), salts), 27);
+        const __m256i mask=_mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+        return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(b.words)), mask);
+    }
+#endif
+
+public:
+    explicit BlockedBloomFilter(const std::uint64_t expected=0, const double bits=10){
+        reset(expected, bits);
+    }
+
+    // Clears the filter and sizes it for expected keys at bits per key.
+    void reset(const std::uint64_t expected, const double bits){
+        bitsPerKey=bits;
+        capacity=std::max<std::uint64_t>(expected, 1024);
+        const std::uint64_t n=static_cast<std::uint64_t>(capacity*bitsPerKey/256)+1;
+        blocks.assign(static_cast<std::size_t>(n), Block{});
+        keys=0;
+        removed=0;
+    }
+
+    void add(const std::uint64_t key){
+        const std::uint64_t h=mix(key);
+        Block& b=blocks[blockOf(h)];
+        const std::uint32_t lo=static_cast<std::uint32_t>(h);
+        for(int i=0; i<8; ++i) b.words[i]|=1U<<((lo*salt[i])>>27);
+        ++keys;
+    }
+
+    bool mayContain(const std::uint64_t key) const{
+        const std::uint64_t h=mix(key);
+        const Block& b=blocks[blockOf(h)];
+#ifdef BLOOM_AVX2
+        if(haveAvx2()) return testAvx2(b, static_cast<std::uint32_t>(h));
+#endif
+        return testScalar(b, static_cast<std::uint32_t>(h));
+    }
+
+    void remove(){
+        ++removed;
+    }
+
+    // True once the set bits describe noticeably more keys than are live, or
+    // more keys than the filter was sized for.
+    bool needsRebuild() const{
+        return keys>capacity || removed*2>keys;
+    }
+
+    std::uint64_t size() const{ return keys-std::min(keys, removed); }
+    std::size_t bytes() const{ return blocks.size()*sizeof(Block); }
+    double bits() const{ return bitsPerKey; }
+
+    void save(std::ostream& out) const{
+        const std::uint64_t n=blocks.size();
+        out.write(reinterpret_cast<const char*>(&bitsPerKey), sizeof(bitsPerKey));
+        out.write(reinterpret_cast<const char*>(&keys), sizeof(keys));
+        out.write(reinterpret_cast<const char*>(&removed), sizeof(removed));
+        out.write(reinterpret_cast<const char*>(&capacity), sizeof(capacity));
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(n*sizeof(Block)));
+    }
+
+    bool load(std::istream& in){
+        std::uint64_t n=0;
+        if(!in.read(reinterpret_cast<char*>(&bitsPerKey), sizeof(bitsPerKey))) return false;
+        if(!in.read(reinterpret_cast<char*>(&keys), sizeof(keys))) return false;
+        if(!in.read(reinterpret_cast<char*>(&removed), sizeof(removed))) return false;
+        if(!in.read(reinterpret_cast<char*>(&capacity), sizeof(capacity))) return false;
+        if(!in.read(reinterpret_cast<char*>(&n), sizeof(n)) || !n) return false;
+        blocks.assign(static_cast<std::size_t>(n), Block{});
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(blocks.data()), static_cast<std::streamsize>(n*sizeof(Block))));
+    }
+};
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+class BufferPoolException: public std::exception{
+    std::string msg;
+public:
+    BufferPoolException(std::string message="Buffer pool I/O failure"): msg(std::move(message)) {}
+    virtual const char* what() const noexcept override { return msg.c_str();}
+};
+
+struct BufferPoolStats{
+    std::uint64_t hits=0;
+    std::uint64_t misses=0;
+    std::uint64_t evictions=0;
+    std::uint64_t writebacks=0;
+    std::uint64_t bytesRead=0;
+    std::uint64_t bytesWritten=0;
+    std::size_t capacity=0;
+    std::size_t pageBytes=0;
+
+    double hitRate() const{
+        return hits+misses? static_cast<double>(hits)/(hits+misses) : 0;
+    }
+};
+
+// Fixed number of frames, each caching one page of the file, replaced with
+// CLOCK. A fetched page stays pinned until its PageRef goes away. Page I/O
+// runs outside the latch; anyone wanting a page that is being loaded or
+// written back waits for it. The bytes of a page are guarded by the caller:
+// concurrent readers, or one writer.
+class BufferPool{
+    struct Frame{
+        std::vector<char> data;
+        long page=-1;
+        std::size_t valid=0;
+        int pins=0;
+        bool dirty=false;
+        bool ref=false;
+        bool loading=false;
+    };
+
+    int fd;
+    std::string path;
+    std::size_t pageBytes;
+    std::vector<Frame> frames;
+    std::unordered_map<long, std::size_t> table;
+    std::unordered_set<long> writingBack;
+    std::size_t hand=0;
+    mutable std::mutex latch;
+    std::condition_variable cv;
+    BufferPoolStats counters;
+
+    void writeFully(const char* p, std::size_t n, off_t off){
+        while(n){
+            const ssize_t w=::pwrite(fd, p, n, off);
+            if(w<0 && errno==EINTR) continue;
+            if(w<0) throw BufferPoolException("Unable to write "+path);
+            p+=w;
+            n-=static_cast<std::size_t>(w);
+            off+=w;
+        }
+    }
+
+    std::size_t readPage(char* p, off_t off){
+        std::size_t got=0;
+        while(got<pageBytes){
+            const ssize_t r=::pread(fd, p+got, pageBytes-got, off+static_cast<off_t>(got));
+            if(r<0 && errno==EINTR) continue;
+            if(r<0) throw BufferPoolException("Unable to read "+path);
+            if(r==0) break;
+            got+=static_cast<std::size_t>(r);
+        }
+        return got;
+    }
+
+    std::size_t victim(std::unique_lock<std::mutex>& lock){
+        while(true){
+            for(std::size_t scanned=0; scanned<2*frames.size(); ++scanned){
+                Frame& f=frames[hand];
+                const std::size_t idx=hand;
+                hand=(hand+1)%frames.size();
+                if(f.pins || f.loading) continue;
+                if(f.ref){
+                    f.ref=false;
+                    continue;
+                }
+                return idx;
+            }
+            cv.wait(lock);
+        }
+    }
+
+    void unpin(const std::size_t idx){
+        std::lock_guard<std::mutex> lock{latch};
+        if(--frames[idx].pins==0) cv.notify_all();
+    }
+
+public:
+    class PageRef{
+        BufferPool* pool;
+        std::size_t idx;
+
+    public:
+        PageRef(BufferPool* p, const std::size_t i): pool{p}, idx{i} {}
+        PageRef(PageRef&& r) noexcept: pool{r.pool}, idx{r.idx} { r.pool=nullptr; }
+        PageRef(const PageRef&)=delete;
+        PageRef& operator=(const PageRef&)=delete;
+        ~PageRef(){
+            if(pool) pool->unpin(idx);
+        }
+
+        const char* data() const{ return pool->frames[idx].data.data(); }
+        char* data(){ return pool->frames[idx].data.data(); }
+
+        void markDirty(const std::size_t end){
+            std::lock_guard<std::mutex> lock{pool->latch};
+            Frame& f=pool->frames[idx];
+            f.dirty=true;
+            f.valid=std::max(f.valid, end);
+        }
+    };
+
+    BufferPool(const std::string& file, const std::size_t pageSize, const std::size_t capacity):
+    path{file}, pageBytes{pageSize}, frames(std::max<std::size_t>(capacity, 1)) {
+        fd=::open(path.c_str(), O_RDWR);
+        if(fd<0) throw BufferPoolException("Unable to open "+path);
+        for(Frame& f : frames) f.data.assign(pageBytes, 0);
+        counters.capacity=frames.size();
+        counters.pageBytes=pageBytes;
+    }
+
+    ~BufferPool(){
+        if(fd>=0) ::close(fd);
+    }
+
+    BufferPool(const BufferPool&)=delete;
+    BufferPool& operator=(const BufferPool&)=delete;
+
+    PageRef fetch(const long page){
+        std::unique_lock<std::mutex> lock{latch};
+        while(true){
+            auto it=table.find(page);
+            if(it!=table.end()){
+                Frame& f=frames[it->second];
+                if(f.loading){
+                    cv.wait(lock);
+                    continue;
+                }
+                ++f.pins;
+                f.ref=true;
+                ++counters.hits;
+                return PageRef(this, it->second);
+            }
+            if(writingBack.count(page)){
+                cv.wait(lock);
+                continue;
+            }
+            break;
+        }
+
+        const std::size_t idx=victim(lock);
+        Frame& f=frames[idx];
+        const long oldPage=f.page;
+        const bool writeBack=f.dirty && oldPage>=0;
+        const std::size_t oldValid=f.valid;
+        if(oldPage>=0){
+            table.erase(oldPage);
+            ++counters.evictions;
+            if(writeBack) writingBack.insert(oldPage);
+        }
+        f.page=page;
+        f.pins=1;
+        f.loading=true;
+        f.dirty=false;
+        f.ref=true;
+        table[page]=idx;
+        ++counters.misses;
+        lock.unlock();
+
+        std::size_t got=0;
+        try{
+            if(writeBack) writeFully(f.data.data(), oldValid, static_cast<off_t>(oldPage)*pageBytes);
+            got=readPage(f.data.data(), static_cast<off_t>(page)*pageBytes);
+        }catch(...){
+            lock.lock();
+            if(writeBack) writingBack.erase(oldPage);
+            table.erase(page);
+            f.page=-1;
+            f.pins=0;
+            f.loading=false;
+            f.valid=0;
+            cv.notify_all();
+            throw;
+        }
+        std::fill(f.data.begin()+got, f.data.end(), 0);
+
+        lock.lock();
+        if(writeBack){
+            writingBack.erase(oldPage);
+            ++counters.writebacks;
+            counters.bytesWritten+=oldValid;
+        }
+        counters.bytesRead+=got;
+        f.valid=got;
+        f.loading=false;
+        cv.notify_all();
+        return PageRef(this, idx);
+    }
+
+    void read(long pos, char* out, std::size_t len){
+        while(len){
+            const long page=pos/static_cast<long>(pageBytes);
+            const std::size_t off=static_cast<std::size_t>(pos-page*static_cast<long>(pageBytes));
+            const std::size_t n=std::min(len, pageBytes-off);
+            PageRef ref=fetch(page);
+            memcpy(out, ref.data()+off, n);
+            out+=n;
+            pos+=static_cast<long>(n);
+            len-=n;
+        }
+    }
+
+    // Copies from the cache only, so the caller can go to the file itself on
+    // false. Waits out a load or write-back of the page, after which a page
+    // that is not resident has nothing newer than the file.
+    bool tryRead(const long pos, char* out, const std::size_t len){
+        const long page=pos/static_cast<long>(pageBytes);
+        const std::size_t off=static_cast<std::size_t>(pos-page*static_cast<long>(pageBytes));
+        if(off+len>pageBytes) return false;
+        std::unique_lock<std::mutex> lock{latch};
+        while(true){
+            auto it=table.find(page);
+            if(it!=table.end() && !frames[it->second].loading){
+                Frame& f=frames[it->second];
+                f.ref=true;
+                ++counters.hits;
+                memcpy(out, f.data.data()+off, len);
+                return true;
+            }
+            if(it==table.end() && !writingBack.count(page)) return false;
+            cv.wait(lock);
+        }
+    }
+
+    void write(long pos, const char* in, std::size_t len){
+        while(len){
+            const long page=pos/static_cast<long>(pageBytes);
+            const std::size_t off=static_cast<std::size_t>(pos-page*static_cast<long>(pageBytes));
+            const std::size_t n=std::min(len, pageBytes-off);
+            PageRef ref=fetch(page);
+            memcpy(ref.data()+off, in, n);
+            ref.markDirty(off+n);
+            in+=n;
+            pos+=static_cast<long>(n);
+            len-=n;
+        }
+    }
+
+    // Forgets everything at or past length so write-back cannot regrow the file.
+    void truncate(const long length){
+        std::lock_guard<std::mutex> lock{latch};
+        for(std::size_t i=0; i<frames.size(); ++i){
+            Frame& f=frames[i];
+            if(f.page<0) continue;
+            const long start=f.page*static_cast<long>(pageBytes);
+            if(start>=length){
+                table.erase(f.page);
+                f.page=-1;
+                f.dirty=false;
+                f.ref=false;
+                f.valid=0;
+            }else if(start+static_cast<long>(f.valid)>length){
+                f.valid=static_cast<std::size_t>(length-start);
+                std::fill(f.data.begin()+f.valid, f.data.end(), 0);
+            }
+        }
+    }
+
+    // Writes back every dirty page; the caller keeps the pages stable.
+    void flush(){
+        std::lock_guard<std::mutex> lock{latch};
+        for(Frame& f : frames){
+            if(!f.dirty || f.page<0) continue;
+            writeFully(f.data.data(), f.valid, static_cast<off_t>(f.page)*pageBytes);
+            f.dirty=false;
+            ++counters.writebacks;
+            counters.bytesWritten+=f.valid;
+        }
+    }
+
+    std::size_t dirtyPages() const{
+        std::lock_guard<std::mutex> lock{latch};
+        return static_cast<std::size_t>(std::count_if(frames.begin(), frames.end(), [](const Frame& f){ return f.dirty; }));
+    }
+
+    BufferPoolStats stats() const{
+        std::lock_guard<std::mutex> lock{latch};
+        return counters;
+    }
+};
+
+#endif
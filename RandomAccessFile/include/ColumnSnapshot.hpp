@@ -0,0 +1,369 @@
+#ifndef _COLUMNSNAPSHOT_H_
+#define _COLUMNSNAPSHOT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ParallelScan.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define COLUMNS_AVX2 1
+#include <immintrin.h>
+#endif
+
+struct ColumnFilter{
+    int yearLo=std::numeric_limits<int>::min();
+    int yearHi=std::numeric_limits<int>::max();
+    long salaryLo=std::numeric_limits<long>::min();
+    long salaryHi=std::numeric_limits<long>::max();
+    bool byCity=false;
+    std::string city;
+};
+
+namespace columns{
+
+struct Bounds{
+    std::int32_t yearLo, yearHi;
+    std::int64_t salaryLo, salaryHi;
+    int city;
+};
+
+struct Columns{
+    const std::int32_t* year;
+    const std::int64_t* salary;
+    const std::uint16_t* city;
+    std::size_t rows;
+};
+
+inline bool accept(const Columns& c, const Bounds& b, const std::size_t i){
+    return c.year[i]>=b.yearLo && c.year[i]<=b.yearHi && c.salary[i]>=b.salaryLo && c.salary[i]<=b.salaryHi
+        && (b.city<0 || c.city[i]==b.city);
+}
+
+inline SalaryStats aggregateScalar(const Columns& c, const Bounds& b){
+    SalaryStats s;
+    for(std::size_t i=0; i<c.rows; ++i){
+        if(accept(c, b, i)) s.add(c.salary[i]);
+    }
+    return s;
+}
+
+template<typename Key>
+void groupScalar(const Columns& c, const Bounds& b, Key key, std::vector<SalaryStats>& groups){
+    for(std::size_t i=0; i<c.rows; ++i){
+        if(accept(c, b, i)) groups[key(i)].add(c.salary[i]);
+    }
+}
+
+#ifdef COLUMNS_AVX2
+inline bool haveAvx2(){
+    static const bool avx2=__builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+// Lanes of the result are all ones for the rows (i .. i+7) whose year or city
+// rejects them.
+__attribute__((target("avx2")))
+inline __m256i rejectYearCity(const Columns& c, const Bounds& b, const std::size_t i){
+    const __m256i y=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.year+i));
+    __m256i bad=_mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(b.yearLo), y),
+                                _mm256_cmpgt_epi32(y, _mm256_set1_epi32(b.yearHi)));
+    if(b.city>=0){
+        const __m256i code=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.city+i)));
+        const __m256i eq=_mm256_cmpeq_epi32(code, _mm256_set1_epi32(b.city));
+        bad=_mm256_or_si256(bad, _mm256_xor_si256(eq, _mm256_set1_epi32(-1)));
+    }
+    return bad;
+}
+
+// Same for four salaries, widened with the matching half of the year/city mask.
+__attribute__((target("avx2")))
+inline __m256i rejectSalary(const Columns& c, const Bounds& b, const std::size_t i, const __m128i yearCity, __m256i& salary){
+    salary=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.salary+i));
+    const __m256i bad=_mm256_or_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x(b.salaryLo), salary),
+                                      _mm256_cmpgt_epi64(salary, _mm256_set1_epi64x(b.salaryHi)));
+    return _mm256_or_si256(bad, _mm256_cvtepi32_epi64(yearCity));
+}
+
+__attribute__((target("avx2")))
+inline SalaryStats aggregateAvx2(const Columns& c, const Bounds& b){
+    __m256i sum=_mm256_setzero_si256();
+    std::uint64_t count=0;
+    std::size_t i=0;
+    for(; i+8<=c.rows; i+=8){
+        const __m256i yc=rejectYearCity(c, b, i);
+        __m256i lo, hi;
+        const __m256i badLo=rejectSalary(c, b, i, _mm256_castsi256_si128(yc), lo);
+        const __m256i badHi=rejectSalary(c, b, i+4, _mm256_extracti128_si256(yc, 1), hi);
+        sum=_mm256_add_epi64(sum, _mm256_add_epi64(_mm256_andnot_si256(badLo, lo), _mm256_andnot_si256(badHi, hi)));
+        const int rejected=_mm256_movemask_pd(_mm256_castsi256_pd(badLo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(badHi))<<4);
+        count+=8-__builtin_popcount(rejected);
+    }
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+
+    SalaryStats s;
+    s.count=count;
+    s.sum=lanes[0]+lanes[1]+lanes[2]+lanes[3];
+    for(; i<c.rows; ++i){
+        if(accept(c, b, i)) s.add(c.salary[i]);
+    }
+    return s;
+}
+
+template<typename Key>
+__attribute__((target("avx2")))
+void groupAvx2(const Columns& c, const Bounds& b, Key key, std::vector<SalaryStats>& groups){
+    std::size_t i=0;
+    for(; i+8<=c.rows; i+=8){
+        const __m256i yc=rejectYearCity(c, b, i);
+        __m256i lo, hi;
+        const __m256i badLo=rejectSalary(c, b, i, _mm256_castsi256_si128(yc), lo);
+        const __m256i badHi=rejectSalary(c, b, i+4, _mm256_extracti128_si256(yc, 1), hi);
+        unsigned int hits=~(_mm256_movemask_pd(_mm256_castsi256_pd(badLo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(badHi))<<4)) & 0xff;
+        while(hits){
+            const std::size_t row=i+__builtin_ctz(hits);
+            groups[key(row)].add(c.salary[row]);
+            hits&=hits-1;
+        }
+    }
+    for(; i<c.rows; ++i){
+        if(accept(c, b, i)) groups[key(i)].add(c.salary[i]);
+    }
+}
+#endif
+
+}
+
+// Column-oriented copy of the live records of a Person file: SIN as uint32,
+// year and salary as contiguous arrays and city as uint16 codes into a
+// dictionary. Filters and aggregates run over the arrays with AVX2 when the
+// CPU has it and a scalar loop otherwise.
+class ColumnSnapshot{
+    std::vector<std::uint32_t> sins;
+    std::vector<std::int32_t> years;
+    std::vector<std::int64_t> salaries;
+    std::vector<std::uint16_t> cities;
+    std::vector<std::string> dict;
+    std::unordered_map<std::string, std::uint16_t> codes;
+    std::int32_t minYear=std::numeric_limits<std::int32_t>::max();
+    std::int32_t maxYear=std::numeric_limits<std::int32_t>::min();
+
+    std::uint16_t codeOf(const std::string_view city){
+        auto it=codes.find(std::string(city));
+        if(it!=codes.end()) return it->second;
+        if(dict.size()>std::numeric_limits<std::uint16_t>::max()) throw std::length_error("too many distinct cities");
+        const std::uint16_t code=static_cast<std::uint16_t>(dict.size());
+        dict.emplace_back(city);
+        codes.emplace(dict.back(), code);
+        return code;
+    }
+
+    columns::Columns view() const{
+        return columns::Columns{years.data(), salaries.data(), cities.data(), years.size()};
+    }
+
+    bool bounds(const ColumnFilter& f, columns::Bounds& b) const{
+        b=columns::Bounds{f.yearLo, f.yearHi, f.salaryLo, f.salaryHi, -1};
+        if(!f.byCity) return true;
+        auto it=codes.find(f.city);
+        if(it==codes.end()) return false;
+        b.city=it->second;
+        return true;
+    }
+
+    template<typename T>
+    static void writeColumn(std::ostream& out, const std::vector<T>& col){
+        out.write(reinterpret_cast<const char*>(col.data()), col.size()*sizeof(T));
+    }
+
+    template<typename T>
+    static void readColumn(std::istream& in, std::vector<T>& col, const std::uint64_t rows){
+        col.resize(rows);
+        if(!in.read(reinterpret_cast<char*>(col.data()), rows*sizeof(T))) throw UnableToOpenFileException("Corrupt column snapshot");
+    }
+
+    static constexpr std::int64_t maxDenseYears=4096;
+
+    template<typename Key>
+    void group(const columns::Bounds& b, Key key, std::vector<SalaryStats>& groups, const bool simd) const{
+#ifdef COLUMNS_AVX2
+        if(simd && columns::haveAvx2()){
+            columns::groupAvx2(view(), b, key, groups);
+            return;
+        }
+#endif
+        columns::groupScalar(view(), b, key, groups);
+    }
+
+    static void collectYears(const std::vector<std::int32_t>& distinct, const std::vector<SalaryStats>& groups, SalaryGroups& res){
+        for(std::size_t g=0; g<groups.size(); ++g){
+            if(groups[g].count) res[std::to_string(distinct[g])]=groups[g];
+        }
+    }
+
+public:
+    void append(const PersonView& r){
+        const std::int32_t year=r.year();
+        sins.push_back(static_cast<std::uint32_t>(r.sin()));
+        years.push_back(year);
+        salaries.push_back(r.salary());
+        cities.push_back(codeOf(r.city()));
+        if(year<minYear) minYear=year;
+        if(year>maxYear) maxYear=year;
+    }
+
+    void merge(ColumnSnapshot&& part){
+        std::vector<std::uint16_t> remap(part.dict.size());
+        for(std::size_t i=0; i<part.dict.size(); ++i) remap[i]=codeOf(part.dict[i]);
+        sins.insert(sins.end(), part.sins.begin(), part.sins.end());
+        years.insert(years.end(), part.years.begin(), part.years.end());
+        salaries.insert(salaries.end(), part.salaries.begin(), part.salaries.end());
+        for(const std::uint16_t c : part.cities) cities.push_back(remap[c]);
+        if(part.minYear<minYear) minYear=part.minYear;
+        if(part.maxYear>maxYear) maxYear=part.maxYear;
+    }
+
+    static ColumnSnapshot build(FileMang<Person>& db, ThreadPool& pool, const ScanOptions& opt=ScanOptions()){
+        return parallelScan<ColumnSnapshot>(db, pool,
+            [](ColumnSnapshot& acc, const PersonView& r){
+                if(!r.isRemoved()) acc.append(r);
+            },
+            [](ColumnSnapshot& into, ColumnSnapshot&& part){
+                into.merge(std::move(part));
+            }, opt);
+    }
+
+    void save(const std::string& path) const{
+        std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if(!out.is_open()) throw UnableToOpenFileException("Unable to create "+path);
+        const std::uint32_t version=1;
+        const std::uint64_t n=sins.size();
+        const std::uint32_t dictSize=static_cast<std::uint32_t>(dict.size());
+        out.write("PCOL", 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char*>(&dictSize), sizeof(dictSize));
+        out.write(reinterpret_cast<const char*>(&minYear), sizeof(minYear));
+        out.write(reinterpret_cast<const char*>(&maxYear), sizeof(maxYear));
+        for(const std::string& city : dict){
+            const std::uint32_t len=static_cast<std::uint32_t>(city.size());
+            out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+            out.write(city.data(), len);
+        }
+        writeColumn(out, sins);
+        writeColumn(out, years);
+        writeColumn(out, salaries);
+        writeColumn(out, cities);
+        if(!out) throw UnableToOpenFileException("Unable to write "+path);
+    }
+
+    static ColumnSnapshot load(const std::string& path){
+        std::ifstream in(path, std::ios::binary);
+        if(!in.is_open()) throw UnableToOpenFileException("Unable to open "+path);
+        char magic[4];
+        std::uint32_t version, dictSize;
+        std::uint64_t n;
+        ColumnSnapshot snap;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&n), sizeof(n));
+        in.read(reinterpret_cast<char*>(&dictSize), sizeof(dictSize));
+        in.read(reinterpret_cast<char*>(&snap.minYear), sizeof(snap.minYear));
+        in.read(reinterpret_cast<char*>(&snap.maxYear), sizeof(snap.maxYear));
+        if(!in || strncmp(magic, "PCOL", sizeof(magic))!=0 || version!=1) throw UnableToOpenFileException("Not a column snapshot: "+path);
+        for(std::uint32_t i=0; i<dictSize; ++i){
+            std::uint32_t len;
+            if(!in.read(reinterpret_cast<char*>(&len), sizeof(len))) throw UnableToOpenFileException("Corrupt column snapshot");
+            std::string city(len, '\0');
+            if(!in.read(&city[0], len)) throw UnableToOpenFileException("Corrupt column snapshot");
+            snap.codeOf(city);
+        }
+        readColumn(in, snap.sins, n);
+        readColumn(in, snap.years, n);
+        readColumn(in, snap.salaries, n);
+        readColumn(in, snap.cities, n);
+        return snap;
+    }
+
+    std::size_t rows() const{
+        return sins.size();
+    }
+
+    std::size_t bytes() const{
+        return sins.size()*(sizeof(std::uint32_t)+sizeof(std::int32_t)+sizeof(std::int64_t)+sizeof(std::uint16_t));
+    }
+
+    static bool simdAvailable(){
+#ifdef COLUMNS_AVX2
+        return columns::haveAvx2();
+#else
+        return false;
+#endif
+    }
+
+    SalaryStats aggregate(const ColumnFilter& f, const bool simd=true) const{
+        columns::Bounds b;
+        if(!bounds(f, b)) return SalaryStats();
+#ifdef COLUMNS_AVX2
+        if(simd && columns::haveAvx2()) return columns::aggregateAvx2(view(), b);
+#endif
+        return columns::aggregateScalar(view(), b);
+    }
+
+    SalaryGroups aggregate(const ColumnFilter& f, const GroupBy by, const bool simd=true) const{
+        SalaryGroups res;
+        if(by==GroupBy::None){
+            const SalaryStats s=aggregate(f, simd);
+            if(s.count) res["all"]=s;
+            return res;
+        }
+        columns::Bounds b;
+        if(!bounds(f, b) || years.empty()) return res;
+
+        const std::uint16_t* city=cities.data();
+        const std::int32_t* year=years.data();
+        const std::int32_t base=minYear;
+        if(by==GroupBy::City){
+            std::vector<SalaryStats> groups(dict.size());
+            group(b, [city](const std::size_t i){ return static_cast<std::size_t>(city[i]); }, groups, simd);
+            for(std::size_t g=0; g<groups.size(); ++g){
+                if(groups[g].count) res[dict[g]]=groups[g];
+            }
+            return res;
+        }
+
+        // Years index the groups directly when they span a few thousand;
+        // otherwise (stray values such as 0 next to 2024) each distinct year
+        // gets a slot found by binary search.
+        std::vector<std::int32_t> distinct;
+        if(static_cast<std::int64_t>(maxYear)-minYear<maxDenseYears){
+            distinct.resize(static_cast<std::size_t>(static_cast<std::int64_t>(maxYear)-minYear)+1);
+            for(std::size_t g=0; g<distinct.size(); ++g) distinct[g]=base+static_cast<std::int32_t>(g);
+            std::vector<SalaryStats> groups(distinct.size());
+            group(b, [year, base](const std::size_t i){ return static_cast<std::size_t>(year[i]-base); }, groups, simd);
+            collectYears(distinct, groups, res);
+        }else{
+            distinct=years;
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+            const std::int32_t* first=distinct.data();
+            const std::int32_t* last=first+distinct.size();
+            std::vector<SalaryStats> groups(distinct.size());
+            group(b, [year, first, last](const std::size_t i){
+                return static_cast<std::size_t>(std::lower_bound(first, last, year[i])-first);
+            }, groups, simd);
+            collectYears(distinct, groups, res);
+        }
+        return res;
+    }
+};
+
+#endif
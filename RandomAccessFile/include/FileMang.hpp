@@ -3,13 +3,42 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <memory>
 #include <string.h>
 #include <exception>
 #include <string>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+#include <future>
+#include <array>
+#include <limits>
+#include <deque>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "Person.hpp"
 #include "SkipSet.hpp"
+#include "BTree.hpp"
+#include "WriteAheadLog.hpp"
+#include "BufferPool.hpp"
+#include "AsyncIo.hpp"
+#include "BloomFilter.hpp"
+#include "SecondaryIndex.hpp"
 
 class UnableToOpenFileException: public std::exception{
     std::string msg;
@@ -18,24 +47,216 @@ public:
     virtual const char* what() const noexcept override { return msg.c_str();}
 };
 
+struct IoStats{
+    std::uint64_t reads=0;
+    std::uint64_t writes=0;
+    std::uint64_t bytesRead=0;
+    std::uint64_t bytesWritten=0;
+    std::uint64_t walRecords=0;
+    std::uint64_t walSyncs=0;
+    std::uint64_t walBytes=0;
+    std::uint64_t relocated=0;
+    std::uint64_t trimmedBytes=0;
+    std::uint64_t asyncReads=0;
+    std::uint64_t asyncRetries=0;
+    std::uint64_t filteredLookups=0;
+};
+
+// Shared mutex that lets a waiting writer in ahead of new readers; the
+// default glibc rwlock would starve updates and compaction under a steady
+// stream of gets.
+class FileLock{
+    pthread_rwlock_t rw;
+
+public:
+    FileLock(){
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&rw, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+    ~FileLock(){ pthread_rwlock_destroy(&rw); }
+
+    FileLock(const FileLock&)=delete;
+    FileLock& operator=(const FileLock&)=delete;
+
+    void lock(){ pthread_rwlock_wrlock(&rw); }
+    bool try_lock(){ return pthread_rwlock_trywrlock(&rw)==0; }
+    void unlock(){ pthread_rwlock_unlock(&rw); }
+    void lock_shared(){ pthread_rwlock_rdlock(&rw); }
+    bool try_lock_shared(){ return pthread_rwlock_tryrdlock(&rw)==0; }
+    void unlock_shared(){ pthread_rwlock_unlock(&rw); }
+};
+
+struct SpaceStats{
+    long fileBytes=0;
+    long liveBytes=0;
+    std::size_t holes=0;
+};
+
+// Every mutation is appended to <file>.wal under the file lock and made durable
+// by a group commit after the lock is released; the record image is written to
+// the data file only once its LSN is durable. Until then reads are served from
+// the unapplied map. A background checkpoint syncs the data file and empties
+// the log, and opening a file replays whatever the log still holds.
+// Record I/O goes through a page cache; lookups share the file lock, anything
+// that changes positions or the log takes it exclusively.
 template<typename F>
 class FileMang{
 private:
-    char fileName[30];
+    std::string fileName;
     std::fstream fmang;
-    SkipSet<long, long> activePos;
-    std::vector<long> inactivePos;
-    mutable std::mutex mtx;
+    BTree<long, long> activePos;
+    std::set<long> inactivePos;
+    long endPos;
+    long recordSize;
+    mutable FileLock mtx;
+    std::atomic<std::uint64_t> reads{0}, writes{0}, bytesRead{0}, bytesWritten{0};
+    std::atomic<std::uint64_t> relocated{0}, trimmedBytes{0};
+    std::atomic<std::uint64_t> asyncReads{0}, asyncRetries{0};
+    std::atomic<std::uint64_t> filteredLookups{0};
+
+    std::unique_ptr<WriteAheadLog> wal;
+    std::unique_ptr<BufferPool> pool;
+    std::size_t cachePages;
+    long pageBytes=0;
+    // Pages held by all open read transactions together.
+    std::atomic<std::size_t> txnPins{0};
+
+    // Async reads bypass the pool and are checked on completion against the
+    // write version of their page stripe.
+    std::unique_ptr<AsyncIo> aio;
+    std::once_flag aioOnce;
+    int dataFd=-1;
+    std::array<std::atomic<std::uint64_t>, 64> pageVersions{};
+    std::map<long, std::pair<std::uint64_t, std::string>> unapplied;
+    std::thread checkpointer;
+    std::condition_variable_any checkpointCv;
+    bool stopping;
+    std::chrono::milliseconds checkpointInterval;
+    static constexpr std::uint64_t checkpointBytes=64<<20;
+
+    std::vector<std::unique_ptr<SecondaryIndex<F>>> indexes;
+    bool indexesDirty=false;
+    std::unique_ptr<BlockedBloomFilter> sinFilter;
+
+    // Logged truncations not yet applied, as (lsn, length) in LSN order.
+    std::deque<std::pair<std::uint64_t, long>> pendingTruncates;
+    std::thread compactor;
+    std::condition_variable_any compactionCv;
+    std::uint64_t compactionRate=0;
+    double compactionTrigger=0;
 
     void init();
+    void open(const bool logged);
+    void recover();
     void fillPos();
-    void add( F& f);
+    std::uint64_t add( F& f);
     bool find(F& f);
+    bool load(F& f);
     void modify(F& f);
-    void applyModification(F& f, long pos);
-    bool remove(F& f);
+    enum class Modified{ Done, Missing, Taken };
+    Modified applyModification(F& f, const long oldSin, std::uint64_t& lsn);
+    std::uint64_t writeAt(F& f, long pos);
+    void readAt(F& f, long pos);
+    bool remove(F& f, std::uint64_t& lsn);
+    void makeDurable(const std::uint64_t lsn);
+    void applyUpTo(const std::uint64_t lsn);
+    void applyWritesUpTo(const std::uint64_t lsn);
+    void checkpoint(const bool withIndexes=true);
+    void checkpointLoop();
+    void syncDataFile();
+    void quiesce();
+    void startAsync(const AsyncBackend kind, const unsigned int depth);
+    template<typename Done>
+    bool prepareRead(const long sin, F& rec, Done& done, std::vector<IoRequest>& batch);
+
+    std::atomic<std::uint64_t>& pageVersion(const long pos){
+        return pageVersions[static_cast<std::size_t>(pos/pageBytes)%pageVersions.size()];
+    }
+
+    void bumpVersions(){
+        for(auto& v : pageVersions) v.fetch_add(1, std::memory_order_release);
+    }
+    std::uint64_t shrinkTo(const long length);
+    bool compactStep(std::uint64_t& lsn);
+    void compactionLoop();
+
+    void attachIndex(std::unique_ptr<SecondaryIndex<F>> index);
+    bool loadIndex(SecondaryIndex<F>& index);
+    void buildIndex(SecondaryIndex<F>& index);
+    void saveIndexes();
+    bool loadFilter();
+    void rebuildFilter();
+    void saveFilter();
+
+    // Only SINs the filter has seen reach the B+-tree descent.
+    bool lookup(const long sin, long& pos){
+        if(sinFilter && !sinFilter->mayContain(static_cast<std::uint64_t>(sin))){
+            filteredLookups.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        pos=-1;
+        return activePos.find(sin, pos) && pos!=-1;
+    }
+
+    void filterAdd(const long sin){
+        if(!sinFilter) return;
+        sinFilter->add(static_cast<std::uint64_t>(sin));
+        indexesDirty=true;
+        if(sinFilter->needsRebuild()) rebuildFilter();
+    }
+
+    void filterRemove(){
+        if(!sinFilter) return;
+        sinFilter->remove();
+        indexesDirty=true;
+        if(sinFilter->needsRebuild()) rebuildFilter();
+    }
+
+    std::string indexPath(const SecondaryIndex<F>& index) const{
+        return fileName+"."+index.name()+".idx";
+    }
+
+    void indexInsert(const F& rec){
+        for(auto& idx : indexes) idx->insert(rec);
+        indexesDirty|=!indexes.empty();
+    }
+
+    void indexErase(const long sin){
+        for(auto& idx : indexes) idx->erase(sin);
+        indexesDirty|=!indexes.empty();
+    }
+
+    // Lets a record image be decoded with readFromFile straight from the page
+    // or log buffer that holds it.
+    struct MemoryBuf: std::streambuf{
+        MemoryBuf(const char* p, const std::size_t n){
+            char* b=const_cast<char*>(p);
+            setg(b, b, b+n);
+        }
+    };
+
+    void decode(F& rec, const char* p) const{
+        MemoryBuf buf(p, static_cast<std::size_t>(recordSize));
+        std::istream in(&buf);
+        rec.readFromFile(in);
+    }
+
+    void countRead(const F& f){
+        reads.fetch_add(1, std::memory_order_relaxed);
+        bytesRead.fetch_add(f.size(), std::memory_order_relaxed);
+    }
+
+    void countWrite(const std::uint64_t bytes){
+        writes.fetch_add(1, std::memory_order_relaxed);
+        bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    }
 
     std::ostream& print(std::ostream& out) {
+        std::lock_guard<FileLock> lock{mtx};
+        quiesce();
         if(fmang.is_open()) fmang.close();
 
         fmang.open(fileName, std::ios::in | std::ios::binary);
@@ -46,10 +267,12 @@ private:
         while(true){
             rec.readFromFile(fmang);
             if(fmang.eof()) break;
+            countRead(rec);
             if(!rec.isRemoved()) std::cout << rec << "\n";
         }
         fmang.close();
         std::cout << "-------------------------------------END-----------------------------------\n";
+        return out;
     }
 
     friend std::ostream& operator<<(std::ostream& out, FileMang& file) {
@@ -57,128 +280,947 @@ private:
     }
 
 public:
-    FileMang(){
+    FileMang(): endPos{0}, recordSize{F().size()}, cachePages{4096}, stopping{false}, checkpointInterval{std::chrono::seconds(1)} {
         init();
     }
 
+    explicit FileMang(std::string name, const bool logged=true,
+                      const std::chrono::milliseconds interval=std::chrono::seconds(1),
+                      const std::size_t cachedPages=4096):
+    fileName{std::move(name)}, endPos{0}, recordSize{F().size()}, cachePages{cachedPages}, stopping{false}, checkpointInterval{interval} {
+        open(logged);
+    }
+
+    ~FileMang(){
+        {
+            std::lock_guard<FileLock> lock{mtx};
+            stopping=true;
+        }
+        checkpointCv.notify_all();
+        compactionCv.notify_all();
+        if(checkpointer.joinable()) checkpointer.join();
+        if(compactor.joinable()) compactor.join();
+        aio.reset();
+        if(dataFd>=0) ::close(dataFd);
+        try{
+            std::lock_guard<FileLock> lock{mtx};
+            checkpoint();
+        }catch(std::exception& ex){
+            std::cerr << "Exception in destruction: " << ex.what() << "\n";
+        }
+    }
+
+    FileMang(const FileMang&)=delete;
+    FileMang& operator=(const FileMang&)=delete;
+
     void run();
 
+    bool get(const long sin, F& rec);
+
+    // A read transaction: holds the file lock shared and hands out views of
+    // record bytes in place, in a pinned cache page or a pending log image.
+    // Every view stays valid until the transaction ends; writers wait for it,
+    // so keep it short and make no other FileMang calls while it is open.
+    // Past the pin budget, a quarter of the cache shared by every open
+    // transaction, records are copied into the transaction instead, so
+    // transactions cannot pin the whole pool between them.
+    class ReadTxn{
+        FileMang* db;
+        std::shared_lock<FileLock> lock;
+        std::vector<BufferPool::PageRef> pins;
+        std::unordered_map<long, const char*> pages;
+        std::deque<std::string> copies;
+
+        const char* bytesOf(const long sin);
+
+    public:
+        explicit ReadTxn(FileMang& file): db{&file}, lock{file.mtx} {}
+
+        ~ReadTxn(){
+            const std::size_t n=pins.size();
+            pins.clear();
+            if(n) db->txnPins.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+        ReadTxn(ReadTxn&&)=default;
+        ReadTxn(const ReadTxn&)=delete;
+        ReadTxn& operator=(const ReadTxn&)=delete;
+
+        // View is constructed from a pointer to the raw record, as PersonView is.
+        template<typename View>
+        bool get(const long sin, View& out){
+            const char* p=bytesOf(sin);
+            if(!p) return false;
+            out=View(p);
+            return true;
+        }
+
+        std::size_t pinned() const{ return pins.size(); }
+        std::size_t copied() const{ return copies.size(); }
+    };
+
+    ReadTxn beginRead(){
+        return ReadTxn(*this);
+    }
+
+    // One-shot form: fn(const View&) runs inside its own read transaction.
+    template<typename View, typename Fn>
+    bool withView(const long sin, Fn fn){
+        ReadTxn txn(*this);
+        View v;
+        if(!txn.get(sin, v)) return false;
+        fn(static_cast<const View&>(v));
+        return true;
+    }
+
+    // The future resolves to what get() would have returned; rec must outlive
+    // it. The batch form hands every read to the backend in one submission.
+    std::future<bool> getAsync(const long sin, F& rec);
+    std::vector<std::future<bool>> getAsync(const std::vector<long>& sins, std::vector<F>& recs);
+
+    // getAsync with the outcome handed to done, anything with set_value(bool)
+    // and set_exception(std::exception_ptr) as std::promise<bool> has. When
+    // the answer is at hand, done hears it before this returns true;
+    // otherwise the read is queued and done hears it on the I/O thread.
+    template<typename Done>
+    bool getThen(const long sin, F& rec, Done done);
+
+    // Picks the backend used by getAsync; only the first call (explicit or
+    // implied by getAsync) has any effect.
+    void useAsyncBackend(const AsyncBackend kind, const unsigned int depth=256){
+        std::call_once(aioOnce, &FileMang::startAsync, this, kind, depth);
+    }
+
+    const char* asyncBackend(){
+        useAsyncBackend(AsyncBackend::Auto);
+        return aio->name();
+    }
+
+    AsyncIoStats asyncStats() const{
+        return aio? aio->stats() : AsyncIoStats();
+    }
+    bool insert(F& rec);
+    bool update(F& rec);
+    bool erase(const long sin);
+
+    void flush(){
+        std::lock_guard<FileLock> lock{mtx};
+        checkpoint();
+    }
+
+    void addHashIndex(const std::string& name, std::function<std::string(const F&)> key){
+        attachIndex(std::unique_ptr<SecondaryIndex<F>>(new HashIndex<F>(name, std::move(key))));
+    }
+
+    void addOrderedIndex(const std::string& name, std::function<long(const F&)> key){
+        attachIndex(std::unique_ptr<SecondaryIndex<F>>(new OrderedIndex<F>(name, std::move(key))));
+    }
+
+    std::vector<F> select(const IndexQuery& query);
+
+    // Keeps a Bloom filter over the live SINs so lookups of absent SINs
+    // (including the duplicate check of every insert) skip activePos.
+    void addSinFilter(const double bitsPerKey=10);
+
+    // Runs fn(path, length) with every logged write applied to the data file
+    // and writers held off, so a full-file reader sees a stable image.
+    template<typename Fn>
+    auto withQuiescedFile(Fn fn){
+        std::lock_guard<FileLock> lock{mtx};
+        quiesce();
+        return fn(static_cast<const std::string&>(fileName), endPos);
+    }
+
+    std::size_t count() const{
+        return activePos.size();
+    }
+
+    // Moves live records from the tail into holes and truncates the file, at
+    // most bytesPerSec of record I/O, whenever holes exceed trigger of the file.
+    void startCompaction(const std::uint64_t bytesPerSec, const double trigger=0.1){
+        std::lock_guard<FileLock> lock{mtx};
+        compactionRate=bytesPerSec;
+        compactionTrigger=trigger;
+        if(!compactor.joinable()) compactor=std::thread(&FileMang::compactionLoop, this);
+        compactionCv.notify_all();
+    }
+
+    void stopCompaction(){
+        {
+            std::lock_guard<FileLock> lock{mtx};
+            compactionRate=0;
+        }
+        compactionCv.notify_all();
+        if(compactor.joinable()) compactor.join();
+    }
+
+    // Compacts until no hole is left, without rate limiting.
+    std::size_t compact(){
+        std::size_t steps=0;
+        bool more=true;
+        while(more){
+            std::uint64_t lsn=0;
+            {
+                std::lock_guard<FileLock> lock{mtx};
+                for(int i=0; i<1024 && more; ++i){
+                    std::uint64_t step=0;
+                    more=compactStep(step);
+                    lsn=std::max(lsn, step);
+                    steps+=more;
+                }
+            }
+            makeDurable(lsn);
+        }
+        return steps;
+    }
+
+    SpaceStats space() const{
+        std::lock_guard<FileLock> lock{mtx};
+        SpaceStats s;
+        s.fileBytes=endPos;
+        s.liveBytes=static_cast<long>(activePos.size())*recordSize;
+        s.holes=inactivePos.size();
+        return s;
+    }
+
+    IoStats ioStats() const{
+        IoStats s;
+        s.reads=reads.load(std::memory_order_relaxed);
+        s.writes=writes.load(std::memory_order_relaxed);
+        s.bytesRead=bytesRead.load(std::memory_order_relaxed);
+        s.bytesWritten=bytesWritten.load(std::memory_order_relaxed);
+        s.relocated=relocated.load(std::memory_order_relaxed);
+        s.trimmedBytes=trimmedBytes.load(std::memory_order_relaxed);
+        s.asyncReads=asyncReads.load(std::memory_order_relaxed);
+        s.asyncRetries=asyncRetries.load(std::memory_order_relaxed);
+        s.filteredLookups=filteredLookups.load(std::memory_order_relaxed);
+        if(wal){
+            const WalStats w=wal->getStats();
+            s.walRecords=w.records;
+            s.walSyncs=w.batches;
+            s.walBytes=w.bytes;
+        }
+        return s;
+    }
+
+    BufferPoolStats cacheStats() const{
+        return pool? pool->stats() : BufferPoolStats();
+    }
+
 };
 
 template<typename F>
-bool FileMang<F>::remove(F& rec){
-    long pos;
-    if(activePos.find(rec.getSIN(), pos) && pos!=-1){
-        if(fmang.is_open()) fmang.close();
+bool FileMang<F>::get(const long sin, F& rec){
+    std::shared_lock<FileLock> lock{mtx};
+    long pos=-1;
+    if(!lookup(sin, pos)) return false;
+    readAt(rec, pos);
+    return true;
+}
 
-        fmang.open(fileName, std::ios::in | std::ios::out | std::ios::binary);
-        if(!fmang.is_open()) throw UnableToOpenFileException();
+template<typename F>
+void FileMang<F>::startAsync(const AsyncBackend kind, const unsigned int depth){
+    dataFd=::open(fileName.c_str(), O_RDONLY);
+    if(dataFd<0) throw UnableToOpenFileException();
+    aio=makeAsyncIo(kind, depth);
+}
 
-        
-        fmang.seekp(pos, std::ios::beg);
-        rec.readFromFile(fmang);
+// Resolves what it can right away: a missing SIN, a record still waiting in
+// the log or one whose page is cached. Otherwise queues a read of the data
+// file. Called under the shared lock; returns true when done was fulfilled.
+template<typename F>
+template<typename Done>
+bool FileMang<F>::prepareRead(const long sin, F& rec, Done& done, std::vector<IoRequest>& batch){
+    long pos=-1;
+    if(!lookup(sin, pos)){
+        done.set_value(false);
+        return true;
+    }
+    if(unapplied.count(pos)){
+        readAt(rec, pos);
+        done.set_value(true);
+        return true;
+    }
+
+    auto buf=std::make_shared<std::string>(static_cast<std::size_t>(recordSize), '\0');
+    if(pool->tryRead(pos, &(*buf)[0], buf->size())){
+        std::istringstream image(std::move(*buf));
+        rec.readFromFile(image);
+        countRead(rec);
+        done.set_value(true);
+        return true;
+    }
+
+    const std::uint64_t version=pageVersion(pos).load(std::memory_order_acquire);
+    auto result=std::make_shared<Done>(std::move(done));
+    IoRequest req;
+    req.fd=dataFd;
+    req.buf=&(*buf)[0];
+    req.len=buf->size();
+    req.off=static_cast<off_t>(pos);
+    req.done=[this, sin, pos, version, buf, result, &rec](const long res){
+        try{
+            std::shared_lock<FileLock> lock{mtx};
+            asyncReads.fetch_add(1, std::memory_order_relaxed);
+            if(res==recordSize && pageVersion(pos).load(std::memory_order_acquire)==version){
+                std::istringstream image(std::move(*buf));
+                rec.readFromFile(image);
+                countRead(rec);
+                result->set_value(true);
+                return;
+            }
+            // The page was written while the read was in flight.
+            asyncRetries.fetch_add(1, std::memory_order_relaxed);
+            long now=-1;
+            if(!activePos.find(sin, now) || now==-1){
+                result->set_value(false);
+                return;
+            }
+            readAt(rec, now);
+            result->set_value(true);
+        }catch(...){
+            result->set_exception(std::current_exception());
+        }
+    };
+    batch.push_back(std::move(req));
+    return false;
+}
+
+template<typename F>
+std::future<bool> FileMang<F>::getAsync(const long sin, F& rec){
+    std::promise<bool> done;
+    std::future<bool> res=done.get_future();
+    getThen(sin, rec, std::move(done));
+    return res;
+}
+
+template<typename F>
+template<typename Done>
+bool FileMang<F>::getThen(const long sin, F& rec, Done done){
+    useAsyncBackend(AsyncBackend::Auto);
+    std::vector<IoRequest> batch;
+    bool ready;
+    {
+        std::shared_lock<FileLock> lock{mtx};
+        ready=prepareRead(sin, rec, done, batch);
+    }
+    if(!batch.empty()) aio->submit(batch);
+    return ready;
+}
+
+template<typename F>
+std::vector<std::future<bool>> FileMang<F>::getAsync(const std::vector<long>& sins, std::vector<F>& recs){
+    useAsyncBackend(AsyncBackend::Auto);
+    recs.resize(sins.size());
+    std::vector<std::future<bool>> res;
+    res.reserve(sins.size());
+    std::vector<IoRequest> batch;
+    {
+        std::shared_lock<FileLock> lock{mtx};
+        for(std::size_t i=0; i<sins.size(); ++i){
+            std::promise<bool> done;
+            res.push_back(done.get_future());
+            prepareRead(sins[i], recs[i], done, batch);
+        }
+    }
+    if(!batch.empty()) aio->submit(batch);
+    return res;
+}
+
+template<typename F>
+const char* FileMang<F>::ReadTxn::bytesOf(const long sin){
+    long pos=-1;
+    if(!db->lookup(sin, pos)) return nullptr;
+    auto pending=db->unapplied.find(pos);
+    if(pending!=db->unapplied.end()) return pending->second.second.data();
+    if(!db->pool) throw UnableToOpenFileException();
+
+    const long page=pos/db->pageBytes;
+    const long off=pos%db->pageBytes;
+    db->reads.fetch_add(1, std::memory_order_relaxed);
+    db->bytesRead.fetch_add(static_cast<std::uint64_t>(db->recordSize), std::memory_order_relaxed);
+    auto it=pages.find(page);
+    if(it!=pages.end()) return it->second+off;
+    const std::size_t budget=std::max<std::size_t>(1, db->cachePages/4);
+    if(db->txnPins.fetch_add(1, std::memory_order_relaxed)<budget){
+        try{
+            pins.push_back(db->pool->fetch(page));
+        }catch(...){
+            db->txnPins.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+        const char* data=pins.back().data();
+        pages.emplace(page, data);
+        return data+off;
+    }
+    db->txnPins.fetch_sub(1, std::memory_order_relaxed);
+    const BufferPool::PageRef ref=db->pool->fetch(page);
+    copies.emplace_back(ref.data()+off, static_cast<std::size_t>(db->recordSize));
+    return copies.back().data();
+}
+
+template<typename F>
+bool FileMang<F>::insert(F& rec){
+    std::uint64_t lsn;
+    {
+        std::lock_guard<FileLock> lock{mtx};
+        long pos=-1;
+        if(lookup(rec.getSIN(), pos)) return false;
+        lsn=add(rec);
+    }
+    makeDurable(lsn);
+    return true;
+}
+
+template<typename F>
+bool FileMang<F>::update(F& rec){
+    std::uint64_t lsn;
+    {
+        std::lock_guard<FileLock> lock{mtx};
+        long pos=-1;
+        if(!lookup(rec.getSIN(), pos)) return false;
+        lsn=writeAt(rec, pos);
+        indexInsert(rec);
+    }
+    makeDurable(lsn);
+    return true;
+}
+
+template<typename F>
+bool FileMang<F>::erase(const long sin){
+    std::uint64_t lsn=0;
+    F rec;
+    rec.setSIN(std::to_string(sin).c_str());
+    {
+        std::lock_guard<FileLock> lock{mtx};
+        if(!remove(rec, lsn)) return false;
+    }
+    makeDurable(lsn);
+    return true;
+}
+
+template<typename F>
+bool FileMang<F>::remove(F& rec, std::uint64_t& lsn){
+    long pos;
+    if(lookup(rec.getSIN(), pos)){
+        readAt(rec, pos);
         rec.setRemoved();
-        fmang.seekp(pos, std::ios::beg);
-        rec.writeToFile(fmang);
+        lsn=writeAt(rec, pos);
 
         activePos.remove(rec.getSIN());
-        inactivePos.push_back(pos);
+        inactivePos.insert(pos);
+        indexErase(rec.getSIN());
+        filterRemove();
 
         return true;
     }
     return false;
 }
 
+// modify() reads the new record before taking the lock, so both SINs are
+// checked again here: the old one may have been erased, or the new one taken,
+// while the user was typing.
 template<typename F>
-void FileMang<F>::applyModification(F& rec, long pos) {
-        rec.readInfoWithoutSIN();
-        if(fmang.is_open()) fmang.close();
+typename FileMang<F>::Modified FileMang<F>::applyModification(F& rec, const long oldSin, std::uint64_t& lsn) {
+        std::lock_guard<FileLock> lock{mtx};
+        long pos=-1;
+        if(!lookup(oldSin, pos)) return Modified::Missing;
+        long taken=-1;
+        if(rec.getSIN()!=oldSin && lookup(rec.getSIN(), taken)) return Modified::Taken;
+        lsn=writeAt(rec, pos);
+        if(rec.getSIN()!=oldSin){
+            long old;
+            activePos.remove(oldSin, old);
+            activePos.add(std::pair<long, long>(rec.getSIN(), pos));
+            indexErase(oldSin);
+            if(sinFilter) sinFilter->remove();
+            filterAdd(rec.getSIN());
+        }
+        indexInsert(rec);
+        return Modified::Done;
+}
 
-        fmang.open(fileName, std::ios::in | std::ios::out | std::ios::binary);
-        if(!fmang.is_open()) throw UnableToOpenFileException();
+template<typename F>
+std::uint64_t FileMang<F>::writeAt(F& rec, long pos) {
+        if(wal){
+            std::ostringstream image;
+            rec.writeToFile(image);
+            std::string bytes=image.str();
+            const std::uint64_t lsn=wal->append(pos, bytes.data(), bytes.size());
+            unapplied[pos]=std::make_pair(lsn, std::move(bytes));
+            return lsn;
+        }
 
-        fmang.seekp(pos, std::ios::beg);
-        rec.writeToFile(fmang);
+        if(!pool) throw UnableToOpenFileException();
+        std::ostringstream image;
+        rec.writeToFile(image);
+        const std::string bytes=image.str();
+        pageVersion(pos).fetch_add(1, std::memory_order_release);
+        pool->write(pos, bytes.data(), bytes.size());
+        countWrite(bytes.size());
+        return 0;
+}
 
-        fmang.close();
+template<typename F>
+void FileMang<F>::readAt(F& rec, long pos) {
+    auto pending=unapplied.find(pos);
+    if(pending!=unapplied.end()){
+        decode(rec, pending->second.second.data());
+        return;
+    }
+
+    if(!pool) throw UnableToOpenFileException();
+    const BufferPool::PageRef page=pool->fetch(pos/pageBytes);
+    decode(rec, page.data()+pos%pageBytes);
+    countRead(rec);
 }
 
 template<typename F>
-void FileMang<F>::modify(F& rec) {
-    long pos = -1;
-    if(activePos.find(rec.getSIN(), pos) && pos != -1){
-        std::cout << "Enter new info: \n";
-        F newRec;
-        
-        newRec.readSIN();
+void FileMang<F>::makeDurable(const std::uint64_t lsn){
+    if(!wal || !lsn) return;
+    wal->commit(lsn);
 
-        if(newRec.getSIN() == rec.getSIN()){
-            try{
-                applyModification(newRec, pos);
-            }catch(std::exception& ex){
-                throw UnableToOpenFileException();
-            }
-        }else{
-            long pos1=-1;
-            if( activePos.find(newRec.getSIN(), pos1) && pos1 != -1 ){
-                std::cout << "The SIN is taken, try new one\n";
-                return;
-            }else {
-                try{
-                    applyModification(newRec, pos);
-                }catch(std::exception& ex){
-                    throw UnableToOpenFileException();
-                }
-            }
+    std::lock_guard<FileLock> lock{mtx};
+    applyUpTo(wal->durableLsn());
+    if(wal->size()>checkpointBytes) checkpointCv.notify_one();
+}
+
+// Durable truncations and writes reach the data file in LSN order: writes
+// logged before a truncation past its new end were dropped by shrinkTo, and
+// writes logged after it must survive it.
+template<typename F>
+void FileMang<F>::applyUpTo(const std::uint64_t lsn){
+    while(!pendingTruncates.empty() && pendingTruncates.front().first<=lsn){
+        const std::pair<std::uint64_t, long> cut=pendingTruncates.front();
+        applyWritesUpTo(cut.first-1);
+        bumpVersions();
+        pool->truncate(cut.second);
+        if(::truncate(fileName.c_str(), cut.second)!=0) throw UnableToOpenFileException("Unable to truncate "+fileName);
+        pendingTruncates.pop_front();
+    }
+    applyWritesUpTo(lsn);
+}
+
+template<typename F>
+void FileMang<F>::applyWritesUpTo(const std::uint64_t lsn){
+    for(auto it=unapplied.begin(); it!=unapplied.end();){
+        if(it->second.first>lsn){
+            ++it;
+            continue;
         }
-    }else{
-        std::cout << "Record does not exist in the file\n";
-        return;
+        pageVersion(it->first).fetch_add(1, std::memory_order_release);
+        pool->write(it->first, it->second.second.data(), it->second.second.size());
+        countWrite(it->second.second.size());
+        it=unapplied.erase(it);
     }
 }
 
 template<typename F>
-bool FileMang<F>::find(F& rec){
-    long pos = -1;
-    if(activePos.find(rec.getSIN(), pos) && pos != -1){
-        if(fmang.is_open()) fmang.close();
+void FileMang<F>::checkpoint(const bool withIndexes){
+    const bool logged= wal && (!unapplied.empty() || wal->size()>0);
+    if(logged){
+        wal->commitAll();
+        applyUpTo(wal->durableLsn());
+    }
+    const bool dirty= pool && pool->dirtyPages()>0;
+    if(dirty) pool->flush();
+    if(logged || dirty) syncDataFile();
+    if(logged) wal->reset();
+    if(withIndexes && indexesDirty){
+        if(!logged && !dirty) syncDataFile();
+        saveIndexes();
+    }
+}
 
-        fmang.open(fileName, std::ios::in | std::ios::binary);
-        if(!fmang.is_open()) throw UnableToOpenFileException();
+template<typename F>
+void FileMang<F>::checkpointLoop(){
+    std::unique_lock<FileLock> lock{mtx};
+    while(!stopping){
+        checkpointCv.wait_for(lock, checkpointInterval);
+        if(stopping) break;
+        try{
+            checkpoint(false);
+        }catch(std::exception& ex){
+            std::cerr << "Exception in checkpoint: " << ex.what() << "\n";
+        }
+    }
+}
 
-        fmang.seekp(pos, std::ios::beg);
+template<typename F>
+void FileMang<F>::syncDataFile(){
+    const int fd=::open(fileName.c_str(), O_RDWR);
+    if(fd<0) throw UnableToOpenFileException();
+    const int rc=::fdatasync(fd);
+    ::close(fd);
+    if(rc!=0) throw UnableToOpenFileException("Unable to sync "+fileName);
+}
+
+// Leaves every logged and cached write in the data file itself.
+template<typename F>
+void FileMang<F>::quiesce(){
+    if(wal){
+        wal->commitAll();
+        applyUpTo(wal->durableLsn());
+    }
+    if(pool) pool->flush();
+}
+
+template<typename F>
+void FileMang<F>::attachIndex(std::unique_ptr<SecondaryIndex<F>> index){
+    std::lock_guard<FileLock> lock{mtx};
+    for(auto& idx : indexes){
+        if(idx->name()==index->name()) throw std::invalid_argument("index "+index->name()+" already exists");
+    }
+    quiesce();
+    if(!loadIndex(*index)){
+        index->clear();
+        buildIndex(*index);
+        indexesDirty=true;
+    }
+    indexes.push_back(std::move(index));
+}
+
+// An index file is only trusted when it was saved against the exact data file
+// we have now; anything written since (including WAL replay) forces a rebuild.
+template<typename F>
+bool FileMang<F>::loadIndex(SecondaryIndex<F>& index){
+    std::ifstream in(indexPath(index), std::ios::binary);
+    if(!in.is_open()) return false;
+
+    char magic[4];
+    std::uint32_t kind;
+    IndexStamp saved;
+    if(!in.read(magic, sizeof(magic)) || strncmp(magic, "SIDX", sizeof(magic))!=0) return false;
+    if(!in.read(reinterpret_cast<char*>(&kind), sizeof(kind)) || kind!=static_cast<std::uint32_t>(index.ordered())) return false;
+    if(!in.read(reinterpret_cast<char*>(&saved.size), sizeof(saved.size))) return false;
+    if(!in.read(reinterpret_cast<char*>(&saved.mtime), sizeof(saved.mtime))) return false;
+    if(saved!=stampOf(fileName)) return false;
+
+    return index.load(in) && index.size()==static_cast<std::size_t>(activePos.size());
+}
+
+template<typename F>
+void FileMang<F>::buildIndex(SecondaryIndex<F>& index){
+    if(fmang.is_open()) fmang.close();
+    fmang.open(fileName, std::ios::in | std::ios::binary);
+    if(!fmang.is_open()) throw UnableToOpenFileException();
+
+    F rec;
+    while(true){
         rec.readFromFile(fmang);
-        std::cout << rec << "\n";
+        if(fmang.eof()) break;
+        countRead(rec);
+        if(!rec.isRemoved()) index.insert(rec);
+    }
+    fmang.close();
+}
 
-        fmang.close();
+template<typename F>
+void FileMang<F>::saveIndexes(){
+    const IndexStamp stamp=stampOf(fileName);
+    const std::uint32_t kinds[]={0, 1};
+    for(auto& idx : indexes){
+        const std::string path=indexPath(*idx);
+        {
+            std::ofstream out(path+".tmp", std::ios::out | std::ios::trunc | std::ios::binary);
+            if(!out.is_open()) throw UnableToOpenFileException("Unable to create "+path);
+            out.write("SIDX", 4);
+            out.write(reinterpret_cast<const char*>(&kinds[idx->ordered()]), sizeof(std::uint32_t));
+            out.write(reinterpret_cast<const char*>(&stamp.size), sizeof(stamp.size));
+            out.write(reinterpret_cast<const char*>(&stamp.mtime), sizeof(stamp.mtime));
+            idx->save(out);
+            if(!out) throw UnableToOpenFileException("Unable to write "+path);
+        }
+        if(std::rename((path+".tmp").c_str(), path.c_str())!=0) throw UnableToOpenFileException("Unable to replace "+path);
+    }
+    if(sinFilter) saveFilter();
+    indexesDirty=false;
+}
+
+template<typename F>
+void FileMang<F>::addSinFilter(const double bitsPerKey){
+    std::lock_guard<FileLock> lock{mtx};
+    if(sinFilter) return;
+    quiesce();
+    sinFilter.reset(new BlockedBloomFilter(activePos.size(), bitsPerKey));
+    if(!loadFilter() || sinFilter->bits()!=bitsPerKey){
+        sinFilter->reset(activePos.size(), bitsPerKey);
+        rebuildFilter();
+        indexesDirty=true;
+    }
+}
+
+// Same trust rule as the index files: the stamp must match the data file.
+template<typename F>
+bool FileMang<F>::loadFilter(){
+    std::ifstream in(fileName+".sin.bloom", std::ios::binary);
+    if(!in.is_open()) return false;
+
+    char magic[4];
+    IndexStamp saved;
+    if(!in.read(magic, sizeof(magic)) || strncmp(magic, "SBLM", sizeof(magic))!=0) return false;
+    if(!in.read(reinterpret_cast<char*>(&saved.size), sizeof(saved.size))) return false;
+    if(!in.read(reinterpret_cast<char*>(&saved.mtime), sizeof(saved.mtime))) return false;
+    if(saved!=stampOf(fileName)) return false;
+
+    return sinFilter->load(in) && sinFilter->size()==static_cast<std::uint64_t>(activePos.size());
+}
+
+// Sized at twice the live count, so a growing file rebuilds every doubling.
+template<typename F>
+void FileMang<F>::rebuildFilter(){
+    sinFilter->reset(2*static_cast<std::uint64_t>(activePos.size()), sinFilter->bits());
+    activePos.forRange(std::numeric_limits<long>::min(), std::numeric_limits<long>::max(), [this](const long sin, const long){
+        sinFilter->add(static_cast<std::uint64_t>(sin));
+    });
+}
+
+template<typename F>
+void FileMang<F>::saveFilter(){
+    const IndexStamp stamp=stampOf(fileName);
+    const std::string path=fileName+".sin.bloom";
+    {
+        std::ofstream out(path+".tmp", std::ios::out | std::ios::trunc | std::ios::binary);
+        if(!out.is_open()) throw UnableToOpenFileException("Unable to create "+path);
+        out.write("SBLM", 4);
+        out.write(reinterpret_cast<const char*>(&stamp.size), sizeof(stamp.size));
+        out.write(reinterpret_cast<const char*>(&stamp.mtime), sizeof(stamp.mtime));
+        sinFilter->save(out);
+        if(!out) throw UnableToOpenFileException("Unable to write "+path);
+    }
+    if(std::rename((path+".tmp").c_str(), path.c_str())!=0) throw UnableToOpenFileException("Unable to replace "+path);
+}
+
+// Drives the query from the most selective term and checks the others against
+// the in-memory indexes, so only matching records are read from the file.
+template<typename F>
+std::vector<F> FileMang<F>::select(const IndexQuery& query){
+    std::shared_lock<FileLock> lock{mtx};
+    std::vector<std::pair<const SecondaryIndex<F>*, const IndexQuery::Term*>> bound;
+    for(const auto& t : query.terms){
+        const SecondaryIndex<F>* found=nullptr;
+        for(auto& idx : indexes){
+            if(idx->name()==t.index) found=idx.get();
+        }
+        if(!found) throw std::invalid_argument("no index named "+t.index);
+        if(t.range && !found->ordered()) throw std::invalid_argument("index "+t.index+" does not support ranges");
+        bound.emplace_back(found, &t);
+    }
+    if(bound.empty()) throw std::invalid_argument("query has no terms");
+
+    std::size_t driver=0, best=bound[0].first->estimate(*bound[0].second);
+    for(std::size_t i=1; i<bound.size(); ++i){
+        const bool preferred= !bound[i].second->range && bound[driver].second->range;
+        const std::size_t est=bound[i].first->estimate(*bound[i].second);
+        if(preferred || (bound[i].second->range==bound[driver].second->range && est<best)){
+            driver=i;
+            best=est;
+        }
+    }
+
+    std::vector<long> sins;
+    bound[driver].first->candidates(*bound[driver].second, sins);
+
+    std::vector<F> res;
+    for(const long sin : sins){
+        bool ok=true;
+        for(std::size_t i=0; i<bound.size() && ok; ++i){
+            if(i!=driver) ok=bound[i].first->matches(*bound[i].second, sin);
+        }
+        long pos=-1;
+        if(!ok || !activePos.find(sin, pos) || pos==-1) continue;
+        F rec;
+        readAt(rec, pos);
+        res.push_back(rec);
+    }
+    return res;
+}
+
+template<typename F>
+std::uint64_t FileMang<F>::shrinkTo(const long length){
+    trimmedBytes.fetch_add(endPos-length, std::memory_order_relaxed);
+    endPos=length;
+    if(!wal){
+        bumpVersions();
+        pool->truncate(length);
+        if(::truncate(fileName.c_str(), length)!=0) throw UnableToOpenFileException("Unable to truncate "+fileName);
+        return 0;
+    }
+    unapplied.erase(unapplied.lower_bound(length), unapplied.end());
+    const std::uint64_t lsn=wal->append(length, nullptr, 0, WriteAheadLog::Truncate);
+    pendingTruncates.emplace_back(lsn, length);
+    return lsn;
+}
+
+// One unit of compaction: drop a hole at the tail, or move the tail record
+// into the lowest hole, re-point its SIN and drop the tail slot. The caller
+// holds the lock, so readers never see the record in both or neither slot.
+template<typename F>
+bool FileMang<F>::compactStep(std::uint64_t& lsn){
+    if(endPos<recordSize || inactivePos.empty()) return false;
+    const long tail=endPos-recordSize;
+    auto hole=inactivePos.find(tail);
+    if(hole!=inactivePos.end()){
+        inactivePos.erase(hole);
+        lsn=shrinkTo(tail);
         return true;
     }
-    return false;
+
+    F rec;
+    readAt(rec, tail);
+    long pos=-1;
+    if(activePos.find(rec.getSIN(), pos) && pos==tail){
+        const long target=*inactivePos.begin();
+        writeAt(rec, target);
+        inactivePos.erase(inactivePos.begin());
+        activePos.remove(rec.getSIN(), pos);
+        activePos.add(std::pair<long, long>(rec.getSIN(), target));
+        relocated.fetch_add(1, std::memory_order_relaxed);
+    }
+    lsn=shrinkTo(tail);
+    return true;
 }
 
+// Token bucket refilled at compactionRate and capped at one second of budget.
+// Steps run in bursts under the lock, released between steps, with a single
+// group commit per burst.
+template<typename F>
+void FileMang<F>::compactionLoop(){
+    std::unique_lock<FileLock> lock{mtx};
+    auto last=std::chrono::steady_clock::now();
+    double budget=0;
+    bool active=false;
+    while(!stopping && compactionRate){
+        compactionCv.wait_for(lock, std::chrono::milliseconds(100));
+        if(stopping || !compactionRate) break;
+        const auto now=std::chrono::steady_clock::now();
+        budget=std::min(budget+compactionRate*std::chrono::duration<double>(now-last).count(), static_cast<double>(compactionRate));
+        last=now;
+
+        const double garbage= endPos? static_cast<double>(inactivePos.size()*recordSize)/endPos : 0;
+        active= !inactivePos.empty() && (active || garbage>compactionTrigger);
+        std::uint64_t lsn=0;
+        try{
+            while(active && budget>=2*recordSize && !stopping){
+                std::uint64_t step=0;
+                if(!compactStep(step)){
+                    active=false;
+                    break;
+                }
+                lsn=std::max(lsn, step);
+                budget-=2*recordSize;
+                lock.unlock();
+                lock.lock();
+            }
+            lock.unlock();
+            makeDurable(lsn);
+            lock.lock();
+        }catch(std::exception& ex){
+            if(!lock.owns_lock()) lock.lock();
+            std::cerr << "Exception in compaction: " << ex.what() << "\n";
+        }
+    }
+}
 
 template<typename F>
-void FileMang<F>::add( F& rec){
-    if(fmang.is_open()) fmang.close();
+void FileMang<F>::recover(){
+    std::lock_guard<FileLock> lock{mtx};
+    if(wal->size()==0) return;
 
+    if(fmang.is_open()) fmang.close();
     fmang.open(fileName, std::ios::in | std::ios::out | std::ios::binary);
+    if(!fmang.is_open()) fmang.open(fileName, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
     if(!fmang.is_open()) throw UnableToOpenFileException();
 
-    if(inactivePos.empty()){
-        std::cout << rec << "\n";
-        fmang.seekp(0,std::ios::end);
-        rec.writeToFile(fmang);
-        long pos=fmang.tellp();
-        activePos.add(std::pair<long, long>(rec.getSIN(), pos-rec.size()));
-    }else{
-        long pos=inactivePos.back();
-        inactivePos.pop_back();
+    wal->replay([this](const WriteAheadLog::RecordType type, const long pos, const char* data, const std::size_t len){
+        if(type==WriteAheadLog::Truncate){
+            fmang.flush();
+            if(::truncate(fileName.c_str(), pos)!=0) throw UnableToOpenFileException("Unable to truncate "+fileName);
+            return;
+        }
         fmang.seekp(pos, std::ios::beg);
-        rec.writeToFile(fmang);
-        activePos.add(std::pair<long, long>(rec.getSIN(), pos));
+        fmang.write(data, len);
+    });
+    fmang.close();
+
+    syncDataFile();
+    wal->reset();
+}
+
+template<typename F>
+void FileMang<F>::open(const bool logged){
+    if(logged){
+        wal.reset(new WriteAheadLog(fileName+".wal"));
+        recover();
     }
+    fillPos();
+    pageBytes=std::max<long>(1, 4096/recordSize)*recordSize;
+    pool.reset(new BufferPool(fileName, static_cast<std::size_t>(pageBytes), cachePages));
+    if(wal) checkpointer=std::thread(&FileMang::checkpointLoop, this);
+}
 
-    fmang.close();
+template<typename F>
+void FileMang<F>::modify(F& rec) {
+    long pos = -1;
+    bool exists;
+    {
+        std::shared_lock<FileLock> lock{mtx};
+        exists=lookup(rec.getSIN(), pos);
+    }
+    if(!exists){
+        std::cout << "Record does not exist in the file\n";
+        return;
+    }
+    std::cout << "Enter new info: \n";
+    F newRec;
+
+    newRec.readSIN();
+    newRec.readInfoWithoutSIN();
+
+    std::uint64_t lsn=0;
+    Modified res;
+    try{
+        res=applyModification(newRec, rec.getSIN(), lsn);
+        if(res==Modified::Done) makeDurable(lsn);
+    }catch(std::exception& ex){
+        throw UnableToOpenFileException();
+    }
+    if(res==Modified::Missing) std::cout << "Record does not exist in the file\n";
+    else if(res==Modified::Taken) std::cout << "The SIN is taken, try new one\n";
+}
+
+template<typename F>
+bool FileMang<F>::find(F& rec){
+    if(load(rec)){
+        std::cout << rec << "\n";
+        return true;
+    }
+    return false;
+}
+
+template<typename F>
+bool FileMang<F>::load(F& rec){
+    std::shared_lock<FileLock> lock{mtx};
+    long pos = -1;
+    if(lookup(rec.getSIN(), pos)){
+        readAt(rec, pos);
+        return true;
+    }
+    return false;
+}
+
+
+template<typename F>
+std::uint64_t FileMang<F>::add( F& rec){
+    const bool append=inactivePos.empty();
+    const long pos= append? endPos : *inactivePos.begin();
+    const std::uint64_t lsn=writeAt(rec, pos);
+    if(append) endPos+=rec.size();
+    else inactivePos.erase(inactivePos.begin());
+    activePos.add(std::pair<long, long>(rec.getSIN(), pos));
+    indexInsert(rec);
+    filterAdd(rec.getSIN());
+    return lsn;
 }
 
 template<typename F>
@@ -186,9 +1228,9 @@ void FileMang<F>::init(){
     char str[80];
     std::cout << "Enter file name: ";
     std::cin.getline(str, 80);
-    strncpy(fileName, str, 30);
+    fileName=str;
     try{
-        fillPos();
+        open(true);
     }catch(std::exception& ex){
         std::cout << "Exception in sonstruction: " << ex.what() << "\n";
     }
@@ -211,7 +1253,12 @@ void FileMang<F>::run() {
                 }else{
                     rec.readInfoWithoutSIN();
                     try{
-                        add(rec);
+                        std::uint64_t lsn;
+                        {
+                            std::lock_guard<FileLock> lock{mtx};
+                            lsn=add(rec);
+                        }
+                        makeDurable(lsn);
                     }catch(std::exception& ex){
                         std::cerr << "Exception: " << ex.what() << "\n";
                     }
@@ -246,7 +1293,14 @@ void FileMang<F>::run() {
         }else if(*options=='4'){
             rec.readSIN();
             try{
-                if(remove(rec)){
+                std::uint64_t lsn=0;
+                bool removed;
+                {
+                    std::lock_guard<FileLock> lock{mtx};
+                    removed=remove(rec, lsn);
+                }
+                if(removed){
+                    makeDurable(lsn);
                     std::cout << "the record successfully deleted\n";
                 }else{
                     std::cout << "reocrd deos not exit in the file\n";
@@ -274,7 +1328,7 @@ void FileMang<F>::run() {
 
 template<typename F>
 void FileMang<F>::fillPos() {
-    std::unique_lock<std::mutex> lock{mtx};
+    std::unique_lock<FileLock> lock{mtx};
     fmang.open(fileName, std::ios::in | std::ios::out | std::ios:: binary);
     if(!fmang.is_open()) {
         throw UnableToOpenFileException();
@@ -284,10 +1338,12 @@ void FileMang<F>::fillPos() {
     while(true){
         rec.readFromFile(fmang);
         if(fmang.eof()) break;
+        countRead(rec);
         long pos=fmang.tellp();
-        
+        endPos=pos;
+
         if(rec.isRemoved()){
-            inactivePos.push_back(pos-rec.size());
+            inactivePos.insert(pos-rec.size());
         }else{
             activePos.add(std::pair<long, long>(rec.getSIN(), pos-rec.size()));
         }
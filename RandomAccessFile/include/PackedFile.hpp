@@ -0,0 +1,373 @@
+#ifndef _PACKEDFILE_H_
+#define _PACKEDFILE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ParallelScan.hpp"
+
+// Version 2 of the Person file format: live records only, variable length and
+// packed into slotted pages. A record is addressed by its RID, the page number
+// in the high bits and the slot in the low 9 (a record takes at least eight
+// bytes of a page with its slot), so reaching it is one slot lookup regardless
+// of the lengths before it.
+//
+//   header   "PPAK", version, page size, page count, record count, offsets of
+//            the city dictionary and the SIN index; padded to one page
+//   page     u16 count, u16 offsets[count]; records are packed down from the
+//            end of the page, so record i spans offsets[i] .. offsets[i-1]
+//   record   varint SIN, u8 length + first name, u8 length + last name,
+//            varint city code, zigzag varint year, zigzag varint salary
+//   cities   u32 count, then u8 length + bytes per city in code order
+//   index    (SIN, RID) pairs as two uint32 each, sorted by SIN
+namespace packed{
+
+constexpr std::uint32_t version=2;
+constexpr std::uint32_t pageBytes=4096;
+constexpr unsigned int slotBits=9;
+constexpr std::uint64_t maxPages=std::uint64_t(1)<<(32-slotBits);
+
+inline void putVarint(std::string& out, std::uint64_t v){
+    while(v>=0x80){
+        out.push_back(static_cast<char>(v | 0x80));
+        v>>=7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline std::uint64_t getVarint(const unsigned char*& p){
+    std::uint64_t v=0;
+    for(int shift=0; ; shift+=7){
+        const unsigned char b=*p++;
+        v|=static_cast<std::uint64_t>(b & 0x7f)<<shift;
+        if(!(b & 0x80)) return v;
+    }
+}
+
+inline std::uint64_t zigzag(const long v){
+    return (static_cast<std::uint64_t>(v)<<1) ^ static_cast<std::uint64_t>(v>>63);
+}
+
+inline long unzigzag(const std::uint64_t v){
+    return static_cast<long>(v>>1) ^ -static_cast<long>(v & 1);
+}
+
+inline void putString(std::string& out, const std::string_view s){
+    const std::size_t len=std::min<std::size_t>(s.size(), std::numeric_limits<std::uint8_t>::max());
+    out.push_back(static_cast<char>(len));
+    out.append(s.data(), len);
+}
+
+inline std::uint16_t load16(const char* p){
+    std::uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+}
+
+// Decoded view of one packed record; the strings point into the mapping and
+// the city dictionary of the PackedFile it came from.
+struct PackedRecord{
+    long sinValue=0;
+    std::string_view first, last, town;
+    int yearValue=0;
+    long salaryValue=0;
+
+    long sin() const{ return sinValue; }
+    std::string_view fname() const{ return first; }
+    std::string_view lname() const{ return last; }
+    std::string_view city() const{ return town; }
+    int year() const{ return yearValue; }
+    long salary() const{ return salaryValue; }
+    bool isRemoved() const{ return false; }
+
+    Person toPerson() const{
+        const std::string sinStr=std::to_string(sinValue);
+        return Person(sinStr.c_str(), std::string(first).c_str(), std::string(last).c_str(), std::string(town).c_str(),
+                      yearValue, salaryValue);
+    }
+};
+
+struct PackStats{
+    std::uint64_t records=0;
+    std::uint64_t pages=0;
+    std::uint64_t cities=0;
+    std::uint64_t sourceBytes=0;
+    std::uint64_t packedBytes=0;
+};
+
+class PackedFile{
+    int fd=-1;
+    const char* base=nullptr;
+    std::size_t length=0;
+    std::uint64_t pages=0, records=0;
+    std::vector<std::string> dict;
+    const char* index=nullptr;
+
+    const char* page(const std::uint64_t p) const{
+        return base+(p+1)*packed::pageBytes;
+    }
+
+    PackedRecord decode(const char* pg, const std::uint16_t slot) const{
+        const unsigned char* p=reinterpret_cast<const unsigned char*>(pg+packed::load16(pg+2+2*slot));
+        PackedRecord r;
+        r.sinValue=static_cast<long>(packed::getVarint(p));
+        r.first=std::string_view(reinterpret_cast<const char*>(p+1), *p);
+        p+=1+*p;
+        r.last=std::string_view(reinterpret_cast<const char*>(p+1), *p);
+        p+=1+*p;
+        const std::uint64_t code=packed::getVarint(p);
+        if(code<dict.size()) r.town=dict[code];
+        r.yearValue=static_cast<int>(packed::unzigzag(packed::getVarint(p)));
+        r.salaryValue=packed::unzigzag(packed::getVarint(p));
+        return r;
+    }
+
+    std::uint32_t indexAt(const std::uint64_t i, const int field) const{
+        std::uint32_t v;
+        memcpy(&v, index+(2*i+field)*sizeof(v), sizeof(v));
+        return v;
+    }
+
+    static void writePage(std::ofstream& out, const std::vector<std::pair<long, std::string>>& recs){
+        std::string pg(packed::pageBytes, '\0');
+        const std::uint16_t count=static_cast<std::uint16_t>(recs.size());
+        memcpy(&pg[0], &count, sizeof(count));
+        std::uint16_t end=packed::pageBytes;
+        for(std::size_t i=0; i<recs.size(); ++i){
+            end=static_cast<std::uint16_t>(end-recs[i].second.size());
+            memcpy(&pg[end], recs[i].second.data(), recs[i].second.size());
+            memcpy(&pg[2+2*i], &end, sizeof(end));
+        }
+        out.write(pg.data(), pg.size());
+    }
+
+public:
+    explicit PackedFile(const std::string& path){
+        fd=::open(path.c_str(), O_RDONLY);
+        if(fd<0) throw UnableToOpenFileException("Unable to open "+path);
+        const off_t size=::lseek(fd, 0, SEEK_END);
+        if(size<static_cast<off_t>(packed::pageBytes)){
+            ::close(fd);
+            throw UnableToOpenFileException("Not a packed Person file: "+path);
+        }
+        length=static_cast<std::size_t>(size);
+        void* m=::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m==MAP_FAILED){
+            ::close(fd);
+            throw UnableToOpenFileException("Unable to map "+path);
+        }
+        base=static_cast<const char*>(m);
+
+        std::uint32_t ver, pgBytes;
+        std::uint64_t dictOff, indexOff;
+        memcpy(&ver, base+4, sizeof(ver));
+        memcpy(&pgBytes, base+8, sizeof(pgBytes));
+        memcpy(&pages, base+12, sizeof(pages));
+        memcpy(&records, base+20, sizeof(records));
+        memcpy(&dictOff, base+28, sizeof(dictOff));
+        memcpy(&indexOff, base+36, sizeof(indexOff));
+        if(strncmp(base, "PPAK", 4)!=0 || ver!=packed::version || pgBytes!=packed::pageBytes
+           || indexOff+records*2*sizeof(std::uint32_t)>length || dictOff+sizeof(std::uint32_t)>indexOff){
+            ::munmap(const_cast<char*>(base), length);
+            ::close(fd);
+            throw UnableToOpenFileException("Not a packed Person file: "+path);
+        }
+
+        std::uint32_t cities;
+        memcpy(&cities, base+dictOff, sizeof(cities));
+        const unsigned char* p=reinterpret_cast<const unsigned char*>(base+dictOff+sizeof(cities));
+        for(std::uint32_t i=0; i<cities; ++i){
+            dict.emplace_back(reinterpret_cast<const char*>(p+1), *p);
+            p+=1+*p;
+        }
+        index=base+indexOff;
+    }
+
+    ~PackedFile(){
+        if(base) ::munmap(const_cast<char*>(base), length);
+        if(fd>=0) ::close(fd);
+    }
+
+    PackedFile(const PackedFile&)=delete;
+    PackedFile& operator=(const PackedFile&)=delete;
+
+    // Writes the live records of db to path in file order, with one pass over
+    // a quiesced data file.
+    static PackStats pack(FileMang<Person>& db, const std::string& path){
+        return db.withQuiescedFile([&path](const std::string& source, const long sourceLength){
+            PackStats stats;
+            stats.sourceBytes=static_cast<std::uint64_t>(sourceLength);
+            std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+            if(!out.is_open()) throw UnableToOpenFileException("Unable to create "+path);
+            out.write(std::string(packed::pageBytes, '\0').data(), packed::pageBytes);
+
+            const int in=::open(source.c_str(), O_RDONLY);
+            if(in<0) throw UnableToOpenFileException("Unable to open "+source);
+            ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            std::unordered_map<std::string, std::uint64_t> codes;
+            std::vector<std::string> dict;
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> rids;
+            std::vector<std::pair<long, std::string>> pending;
+            std::size_t used=2;
+            auto flush=[&]{
+                if(stats.pages==packed::maxPages) throw std::length_error("too many pages for a packed file");
+                for(std::size_t i=0; i<pending.size(); ++i){
+                    rids.emplace_back(static_cast<std::uint32_t>(pending[i].first),
+                                      static_cast<std::uint32_t>((stats.pages<<packed::slotBits) | i));
+                }
+                writePage(out, pending);
+                ++stats.pages;
+                pending.clear();
+                used=2;
+            };
+
+            const std::uint64_t recSize=PersonLayout::size;
+            const std::uint64_t total=static_cast<std::uint64_t>(sourceLength)/recSize;
+            std::vector<char> buf;
+            std::string rec;
+            try{
+                for(std::uint64_t first=0; first<total; first+=50000){
+                    const std::uint64_t count=std::min<std::uint64_t>(50000, total-first);
+                    buf.resize(count*recSize);
+                    preadFully(in, buf.data(), buf.size(), static_cast<off_t>(first*recSize));
+                    for(std::uint64_t i=0; i<count; ++i){
+                        const PersonView r(buf.data()+i*recSize);
+                        if(r.isRemoved()) continue;
+                        auto code=codes.find(std::string(r.city()));
+                        if(code==codes.end()){
+                            code=codes.emplace(std::string(r.city()), dict.size()).first;
+                            dict.emplace_back(r.city());
+                        }
+                        rec.clear();
+                        packed::putVarint(rec, static_cast<std::uint64_t>(r.sin()));
+                        packed::putString(rec, r.fname());
+                        packed::putString(rec, r.lname());
+                        packed::putVarint(rec, code->second);
+                        packed::putVarint(rec, packed::zigzag(r.year()));
+                        packed::putVarint(rec, packed::zigzag(r.salary()));
+                        if(used+2+rec.size()>packed::pageBytes) flush();
+                        pending.emplace_back(r.sin(), rec);
+                        used+=2+rec.size();
+                    }
+                }
+                if(!pending.empty()) flush();
+            }catch(...){
+                ::close(in);
+                throw;
+            }
+            ::close(in);
+
+            std::sort(rids.begin(), rids.end());
+
+            const std::uint64_t dictOff=(stats.pages+1)*packed::pageBytes;
+            std::string tail;
+            const std::uint32_t cities=static_cast<std::uint32_t>(dict.size());
+            tail.append(reinterpret_cast<const char*>(&cities), sizeof(cities));
+            for(const std::string& city : dict) packed::putString(tail, city);
+            out.write(tail.data(), tail.size());
+            const std::uint64_t indexOff=dictOff+tail.size();
+            for(const auto& e : rids){
+                out.write(reinterpret_cast<const char*>(&e.first), sizeof(e.first));
+                out.write(reinterpret_cast<const char*>(&e.second), sizeof(e.second));
+            }
+
+            stats.records=rids.size();
+            stats.cities=dict.size();
+            const std::uint32_t ver=packed::version, pgBytes=packed::pageBytes;
+            out.seekp(0);
+            out.write("PPAK", 4);
+            out.write(reinterpret_cast<const char*>(&ver), sizeof(ver));
+            out.write(reinterpret_cast<const char*>(&pgBytes), sizeof(pgBytes));
+            out.write(reinterpret_cast<const char*>(&stats.pages), sizeof(stats.pages));
+            out.write(reinterpret_cast<const char*>(&stats.records), sizeof(stats.records));
+            out.write(reinterpret_cast<const char*>(&dictOff), sizeof(dictOff));
+            out.write(reinterpret_cast<const char*>(&indexOff), sizeof(indexOff));
+            out.flush();
+            if(!out) throw UnableToOpenFileException("Unable to write "+path);
+            stats.packedBytes=indexOff+rids.size()*2*sizeof(std::uint32_t);
+            return stats;
+        });
+    }
+
+    std::uint64_t size() const{ return records; }
+    std::uint64_t pageCount() const{ return pages; }
+    std::size_t bytes() const{ return length; }
+
+    PackedRecord at(const std::uint64_t rid) const{
+        const std::uint64_t p=rid>>packed::slotBits;
+        const std::uint16_t slot=static_cast<std::uint16_t>(rid & ((1U<<packed::slotBits)-1));
+        if(p>=pages || slot>=packed::load16(page(p))) throw std::out_of_range("no record at RID "+std::to_string(rid));
+        return decode(page(p), slot);
+    }
+
+    bool find(const long sin, PackedRecord& out) const{
+        std::uint64_t lo=0, hi=records;
+        while(lo<hi){
+            const std::uint64_t mid=lo+(hi-lo)/2;
+            if(indexAt(mid, 0)<sin) lo=mid+1;
+            else hi=mid;
+        }
+        if(lo==records || static_cast<long>(indexAt(lo, 0))!=sin) return false;
+        out=at(indexAt(lo, 1));
+        return true;
+    }
+
+    // Same contract as scanFile: fold(Acc&, const PackedRecord&) per record on
+    // page ranges spread over the pool, merged in file order.
+    template<typename Acc, typename Fold, typename Merge>
+    Acc scan(ThreadPool& pool, Fold fold, Merge merge, const std::uint64_t pagesPerTask=256) const{
+        std::vector<std::future<Acc>> parts;
+        for(std::uint64_t first=0; first<pages; first+=pagesPerTask){
+            const std::uint64_t last=std::min(pages, first+pagesPerTask);
+            parts.push_back(pool.submit([this, first, last, &fold]{
+                Acc acc{};
+                for(std::uint64_t p=first; p<last; ++p){
+                    const char* pg=page(p);
+                    const std::uint16_t count=packed::load16(pg);
+                    for(std::uint16_t s=0; s<count; ++s) fold(acc, decode(pg, s));
+                }
+                return acc;
+            }));
+        }
+        Acc res{};
+        std::exception_ptr err;
+        for(auto& part : parts){
+            try{
+                merge(res, part.get());
+            }catch(...){
+                if(!err) err=std::current_exception();
+            }
+        }
+        if(err) std::rethrow_exception(err);
+        return res;
+    }
+};
+
+template<typename Pred>
+SalaryGroups aggregateSalary(const PackedFile& file, ThreadPool& pool, const GroupBy by, Pred pred){
+    return file.scan<SalaryGroups>(pool,
+        [by, &pred](SalaryGroups& acc, const PackedRecord& r){
+            if(pred(r)) addToGroup(acc, by, r);
+        },
+        [](SalaryGroups& into, SalaryGroups&& part){
+            for(const auto& g : part) into[g.first].merge(g.second);
+        });
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef _PARALLELSCAN_H_
+#define _PARALLELSCAN_H_
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Person.hpp"
+#include "FileMang.hpp"
+#include "ThreadPool.hpp"
+
+struct ScanOptions{
+    std::size_t chunkBytes=4<<20;
+    bool mmap=false;
+};
+
+struct ScanStats{
+    std::uint64_t records=0;
+    std::uint64_t bytes=0;
+    std::uint64_t chunks=0;
+};
+
+inline void preadFully(const int fd, char* buf, std::size_t n, off_t off){
+    while(n){
+        const ssize_t r=::pread(fd, buf, n, off);
+        if(r<0 && errno==EINTR) continue;
+        if(r<=0) throw UnableToOpenFileException("Short read in scan");
+        buf+=r;
+        n-=static_cast<std::size_t>(r);
+        off+=r;
+    }
+}
+
+// Splits the first length bytes of a Person file into record-aligned chunks,
+// folds each chunk into its own Acc on the pool and merges the partial results
+// in file order. fold(Acc&, const PersonView&) runs concurrently on different
+// accumulators, so it must not share mutable state.
+template<typename Acc, typename Fold, typename Merge>
+Acc scanFile(const std::string& path, const long length, ThreadPool& pool, Fold fold, Merge merge,
+             const ScanOptions& opt=ScanOptions(), ScanStats* stats=nullptr){
+    const std::uint64_t recSize=PersonLayout::size;
+    const std::uint64_t records=length>0? static_cast<std::uint64_t>(length)/recSize : 0;
+    const std::uint64_t perChunk=std::max<std::uint64_t>(1, opt.chunkBytes/recSize);
+
+    const int fd=::open(path.c_str(), O_RDONLY);
+    if(fd<0) throw UnableToOpenFileException("Unable to open "+path);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    const char* mapped=nullptr;
+    if(opt.mmap && records){
+        void* m=::mmap(nullptr, records*recSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m==MAP_FAILED){
+            ::close(fd);
+            throw UnableToOpenFileException("Unable to map "+path);
+        }
+        ::madvise(m, records*recSize, MADV_SEQUENTIAL);
+        mapped=static_cast<const char*>(m);
+    }
+
+    std::vector<std::future<Acc>> parts;
+    for(std::uint64_t first=0; first<records; first+=perChunk){
+        const std::uint64_t count=std::min(perChunk, records-first);
+        parts.push_back(pool.submit([=, &fold]{
+            static thread_local std::vector<char> buf;
+            const char* base;
+            if(mapped){
+                base=mapped+first*recSize;
+            }else{
+                buf.resize(count*recSize);
+                preadFully(fd, buf.data(), count*recSize, static_cast<off_t>(first*recSize));
+                base=buf.data();
+            }
+            Acc acc{};
+            for(std::uint64_t i=0; i<count; ++i) fold(acc, PersonView(base+i*recSize));
+            return acc;
+        }));
+    }
+
+    Acc res{};
+    std::exception_ptr err;
+    for(auto& part : parts){
+        try{
+            merge(res, part.get());
+        }catch(...){
+            if(!err) err=std::current_exception();
+        }
+    }
+    if(mapped) ::munmap(const_cast<char*>(mapped), records*recSize);
+    ::close(fd);
+    if(err) std::rethrow_exception(err);
+
+    if(stats){
+        stats->records+=records;
+        stats->bytes+=records*recSize;
+        stats->chunks+=parts.size();
+    }
+    return res;
+}
+
+template<typename Acc, typename Fold, typename Merge>
+Acc parallelScan(FileMang<Person>& db, ThreadPool& pool, Fold fold, Merge merge,
+                 const ScanOptions& opt=ScanOptions(), ScanStats* stats=nullptr){
+    return db.withQuiescedFile([&](const std::string& path, const long length){
+        return scanFile<Acc>(path, length, pool, fold, merge, opt, stats);
+    });
+}
+
+struct SalaryStats{
+    std::uint64_t count=0;
+    long long sum=0;
+
+    void add(const long salary){
+        ++count;
+        sum+=salary;
+    }
+
+    void merge(const SalaryStats& s){
+        count+=s.count;
+        sum+=s.sum;
+    }
+
+    double avg() const{
+        return count? static_cast<double>(sum)/count : 0;
+    }
+};
+
+enum class GroupBy{ None, City, Year };
+
+typedef std::map<std::string, SalaryStats, std::less<>> SalaryGroups;
+
+// Adds r's salary to its group; Rec is anything with city(), year() and
+// salary(), so row and packed records share the grouping.
+template<typename Rec>
+void addToGroup(SalaryGroups& acc, const GroupBy by, const Rec& r){
+    char buf[16];
+    std::string_view key="all";
+    if(by==GroupBy::City){
+        key=r.city();
+    }else if(by==GroupBy::Year){
+        const auto res=std::to_chars(buf, buf+sizeof(buf), r.year());
+        key=std::string_view(buf, res.ptr-buf);
+    }
+    auto it=acc.find(key);
+    if(it==acc.end()) it=acc.emplace(std::string(key), SalaryStats()).first;
+    it->second.add(r.salary());
+}
+
+// count / sum / avg of salary over the live records accepted by pred, grouped
+// by city or year. Groups are keyed by their text so both share one map type.
+template<typename Pred>
+SalaryGroups aggregateSalary(FileMang<Person>& db, ThreadPool& pool, const GroupBy by, Pred pred,
+                             const ScanOptions& opt=ScanOptions(), ScanStats* stats=nullptr){
+    auto fold=[by, &pred](SalaryGroups& acc, const PersonView& r){
+        if(!r.isRemoved() && pred(r)) addToGroup(acc, by, r);
+    };
+    auto merge=[](SalaryGroups& into, SalaryGroups&& part){
+        for(const auto& g : part) into[g.first].merge(g.second);
+    };
+    return parallelScan<SalaryGroups>(db, pool, fold, merge, opt, stats);
+}
+
+#endif
@@ -3,8 +3,67 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <string_view>
 #include <string.h>
 
+// On-disk record layout: fixed-width NUL-padded strings followed by the raw
+// year and salary, no padding between fields.
+struct PersonLayout{
+    static constexpr std::size_t sinLen=9, fnameLen=20, lnameLen=20, cityLen=20;
+    static constexpr std::size_t sinOff=0;
+    static constexpr std::size_t fnameOff=sinOff+sinLen;
+    static constexpr std::size_t lnameOff=fnameOff+fnameLen;
+    static constexpr std::size_t cityOff=lnameOff+lnameLen;
+    static constexpr std::size_t yearOff=cityOff+cityLen;
+    static constexpr std::size_t salaryOff=yearOff+sizeof(int);
+    static constexpr std::size_t size=salaryOff+sizeof(long);
+};
+
+// Read-only view of one raw Person record in the layout above; decodes fields
+// in place, without the copies and stream reads of Person::readFromFile. It
+// borrows the bytes, so it is valid only as long as whatever handed it out
+// says the memory is.
+class PersonView{
+    const char* rec;
+
+    std::string_view field(const std::size_t off, const std::size_t len) const{
+        return std::string_view(rec+off, strnlen(rec+off, len));
+    }
+
+public:
+    PersonView(): rec{nullptr} {}
+    explicit PersonView(const char* p): rec{p} {}
+
+    const char* data() const{ return rec; }
+
+    long sin() const{
+        long v=0;
+        for(std::size_t i=0; i<PersonLayout::sinLen && rec[i]>='0' && rec[i]<='9'; ++i) v=v*10+(rec[i]-'0');
+        return v;
+    }
+
+    std::string_view fname() const{ return field(PersonLayout::fnameOff, PersonLayout::fnameLen); }
+    std::string_view lname() const{ return field(PersonLayout::lnameOff, PersonLayout::lnameLen); }
+    std::string_view city() const{ return field(PersonLayout::cityOff, PersonLayout::cityLen); }
+
+    int year() const{
+        int v;
+        memcpy(&v, rec+PersonLayout::yearOff, sizeof(v));
+        return v;
+    }
+
+    long salary() const{
+        long v;
+        memcpy(&v, rec+PersonLayout::salaryOff, sizeof(v));
+        return v;
+    }
+
+    bool isRemoved() const{
+        return rec[PersonLayout::fnameOff]=='#';
+    }
+};
+
 class Person{
 private:
     const size_t SINLen, fnameLen, lnameLen, cityLen;
@@ -27,6 +86,9 @@ private:
 public:
     Person();
     Person(const char*, const char*, const char*, const char*, const int, const long);
+    Person(const Person&);
+    Person& operator=(const Person&);
+    ~Person();
 
     void readSIN(){
         char str[80];
@@ -35,8 +97,8 @@ public:
         strncpy(SIN, str, SINLen);
     }
 
-    void readFromFile(std::fstream&);
-    void writeToFile(std::fstream&);
+    void readFromFile(std::istream&);
+    void writeToFile(std::ostream&);
 
     bool isRemoved() const{
         return fname[0]=='#';
@@ -58,6 +120,18 @@ public:
         strncpy(SIN, sin, SINLen);
     }
 
+    std::string getCity() const {
+        return std::string(city, strnlen(city, cityLen));
+    }
+
+    int getYear() const {
+        return year;
+    }
+
+    long getSalary() const {
+        return salary;
+    }
+
     void readInfoWithoutSIN();
 };
 
@@ -0,0 +1,242 @@
+#ifndef _SECONDARYINDEX_H_
+#define _SECONDARYINDEX_H_
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "SkipSet.hpp"
+
+// Identifies the data file contents an index was saved against.
+struct IndexStamp{
+    std::uint64_t size=0;
+    std::int64_t mtime=0;
+
+    bool operator==(const IndexStamp& s) const{ return size==s.size && mtime==s.mtime; }
+    bool operator!=(const IndexStamp& s) const{ return !(*this==s); }
+};
+
+inline IndexStamp stampOf(const std::string& file){
+    IndexStamp s;
+    struct stat st;
+    if(::stat(file.c_str(), &st)==0){
+        s.size=static_cast<std::uint64_t>(st.st_size);
+        s.mtime=static_cast<std::int64_t>(st.st_mtim.tv_sec)*1000000000+st.st_mtim.tv_nsec;
+    }
+    return s;
+}
+
+struct IndexQuery{
+    struct Term{
+        std::string index;
+        bool range;
+        std::string key;
+        long lo, hi;
+    };
+    std::vector<Term> terms;
+
+    IndexQuery& equals(std::string index, std::string key){
+        terms.push_back(Term{std::move(index), false, std::move(key), 0, 0});
+        return *this;
+    }
+
+    IndexQuery& between(std::string index, const long lo, const long hi){
+        terms.push_back(Term{std::move(index), true, "", lo, hi});
+        return *this;
+    }
+};
+
+// Indexes map field values to SINs; FileMang resolves SINs to positions
+// through activePos, so records can move without touching the indexes.
+template<typename F>
+class SecondaryIndex{
+    std::string indexName;
+
+public:
+    explicit SecondaryIndex(std::string name): indexName{std::move(name)} {}
+    virtual ~SecondaryIndex()=default;
+
+    const std::string& name() const{ return indexName; }
+
+    virtual bool ordered() const=0;
+    virtual void insert(const F& rec)=0;
+    virtual void erase(const long sin)=0;
+    virtual void clear()=0;
+    virtual std::size_t size() const=0;
+    virtual std::size_t estimate(const IndexQuery::Term& t) const=0;
+    virtual void candidates(const IndexQuery::Term& t, std::vector<long>& sins) const=0;
+    virtual bool matches(const IndexQuery::Term& t, const long sin) const=0;
+    virtual void save(std::ostream& out) const=0;
+    virtual bool load(std::istream& in)=0;
+};
+
+template<typename F>
+class HashIndex: public SecondaryIndex<F>{
+    std::function<std::string(const F&)> keyOf;
+    std::unordered_map<std::string, std::unordered_set<long>> buckets;
+    std::unordered_map<long, std::string> keys;
+
+    void put(const long sin, std::string key){
+        buckets[key].insert(sin);
+        keys[sin]=std::move(key);
+    }
+
+public:
+    HashIndex(std::string name, std::function<std::string(const F&)> key):
+    SecondaryIndex<F>(std::move(name)), keyOf{std::move(key)} {}
+
+    bool ordered() const override{ return false; }
+
+    void insert(const F& rec) override{
+        const long sin=rec.getSIN();
+        erase(sin);
+        put(sin, keyOf(rec));
+    }
+
+    void erase(const long sin) override{
+        auto it=keys.find(sin);
+        if(it==keys.end()) return;
+        auto bucket=buckets.find(it->second);
+        bucket->second.erase(sin);
+        if(bucket->second.empty()) buckets.erase(bucket);
+        keys.erase(it);
+    }
+
+    void clear() override{
+        buckets.clear();
+        keys.clear();
+    }
+
+    std::size_t size() const override{ return keys.size(); }
+
+    std::size_t estimate(const IndexQuery::Term& t) const override{
+        auto bucket=buckets.find(t.key);
+        return bucket==buckets.end()? 0 : bucket->second.size();
+    }
+
+    void candidates(const IndexQuery::Term& t, std::vector<long>& sins) const override{
+        auto bucket=buckets.find(t.key);
+        if(bucket!=buckets.end()) sins.insert(sins.end(), bucket->second.begin(), bucket->second.end());
+    }
+
+    bool matches(const IndexQuery::Term& t, const long sin) const override{
+        auto it=keys.find(sin);
+        return it!=keys.end() && it->second==t.key;
+    }
+
+    void save(std::ostream& out) const override{
+        const std::uint64_t n=keys.size();
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        for(const auto& e : keys){
+            const std::uint32_t len=static_cast<std::uint32_t>(e.second.size());
+            out.write(reinterpret_cast<const char*>(&e.first), sizeof(e.first));
+            out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+            out.write(e.second.data(), len);
+        }
+    }
+
+    bool load(std::istream& in) override{
+        std::uint64_t n=0;
+        if(!in.read(reinterpret_cast<char*>(&n), sizeof(n))) return false;
+        for(std::uint64_t i=0; i<n; ++i){
+            long sin;
+            std::uint32_t len;
+            if(!in.read(reinterpret_cast<char*>(&sin), sizeof(sin)) || !in.read(reinterpret_cast<char*>(&len), sizeof(len))) return false;
+            std::string key(len, '\0');
+            if(!in.read(&key[0], len)) return false;
+            put(sin, std::move(key));
+        }
+        return true;
+    }
+};
+
+// SkipSet keys must be unique, so duplicates are told apart by folding the SIN
+// (below 10^9) into the low digits; indexed values must stay within +-9.2e9.
+template<typename F>
+class OrderedIndex: public SecondaryIndex<F>{
+    static constexpr long sinSpan=1000000000;
+
+    std::function<long(const F&)> keyOf;
+    std::unique_ptr<SkipSet<long, long>> entries;
+    std::unordered_map<long, long> values;
+
+    static long compose(const long value, const long sin){
+        return value*sinSpan+sin;
+    }
+
+    void put(const long sin, const long value){
+        entries->add(std::pair<long, long>(compose(value, sin), sin));
+        values[sin]=value;
+    }
+
+public:
+    OrderedIndex(std::string name, std::function<long(const F&)> key):
+    SecondaryIndex<F>(std::move(name)), keyOf{std::move(key)}, entries{new SkipSet<long, long>()} {}
+
+    bool ordered() const override{ return true; }
+
+    void insert(const F& rec) override{
+        const long sin=rec.getSIN();
+        erase(sin);
+        put(sin, keyOf(rec));
+    }
+
+    void erase(const long sin) override{
+        auto it=values.find(sin);
+        if(it==values.end()) return;
+        long v;
+        entries->remove(compose(it->second, sin), v);
+        values.erase(it);
+    }
+
+    void clear() override{
+        entries.reset(new SkipSet<long, long>());
+        values.clear();
+    }
+
+    std::size_t size() const override{ return values.size(); }
+
+    std::size_t estimate(const IndexQuery::Term&) const override{
+        return values.size();
+    }
+
+    void candidates(const IndexQuery::Term& t, std::vector<long>& sins) const override{
+        entries->forRange(compose(t.lo, 0), compose(t.hi, sinSpan-1), [&sins](const long, const long sin){
+            sins.push_back(sin);
+        });
+    }
+
+    bool matches(const IndexQuery::Term& t, const long sin) const override{
+        auto it=values.find(sin);
+        return it!=values.end() && it->second>=t.lo && it->second<=t.hi;
+    }
+
+    void save(std::ostream& out) const override{
+        const std::uint64_t n=values.size();
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        for(const auto& e : values){
+            out.write(reinterpret_cast<const char*>(&e.first), sizeof(e.first));
+            out.write(reinterpret_cast<const char*>(&e.second), sizeof(e.second));
+        }
+    }
+
+    bool load(std::istream& in) override{
+        std::uint64_t n=0;
+        if(!in.read(reinterpret_cast<char*>(&n), sizeof(n))) return false;
+        for(std::uint64_t i=0; i<n; ++i){
+            long sin, value;
+            if(!in.read(reinterpret_cast<char*>(&sin), sizeof(sin)) || !in.read(reinterpret_cast<char*>(&value), sizeof(value))) return false;
+            put(sin, value);
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef _SHARDEDFILEMANG_H_
+#define _SHARDEDFILEMANG_H_
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Person.hpp"
+#include "FileMang.hpp"
+#include "ParallelScan.hpp"
+#include "ThreadPool.hpp"
+
+// SINs hash-partitioned over N FileMang shards, each with its own data file,
+// log, index and cache, so the files can live on different devices. Point
+// operations go straight to the owning shard from the calling thread; batches
+// and scans are fanned out to one worker per shard and merged in shard order.
+// Every shard file carries a <file>.shard note of its place in the set, so a
+// file cannot be reopened under a different shard count and lose its records.
+template<typename F>
+class ShardedFileMang{
+    std::vector<std::unique_ptr<FileMang<F>>> shards;
+    std::vector<std::unique_ptr<ThreadPool>> workers;
+
+    static void claim(const std::string& path, const std::size_t index, const std::size_t count){
+        std::ifstream note(path+".shard");
+        std::size_t i=0, n=0;
+        if(note >> i >> n){
+            if(i!=index || n!=count){
+                throw UnableToOpenFileException(path+" is shard "+std::to_string(i)+" of "+std::to_string(n)
+                                                +", not "+std::to_string(index)+" of "+std::to_string(count));
+            }
+            return;
+        }
+        std::ifstream data(path, std::ios::binary | std::ios::ate);
+        if(data.is_open() && data.tellg()>0) throw UnableToOpenFileException(path+" holds records but is not a shard");
+        std::ofstream(path, std::ios::app | std::ios::binary);
+        std::ofstream out(path+".shard", std::ios::trunc);
+        if(!(out << index << " " << count << "\n")) throw UnableToOpenFileException("Unable to create "+path+".shard");
+    }
+
+    // Runs fn(shard, i) for every shard on its worker; the first exception is
+    // rethrown once all of them have finished.
+    template<typename Fn>
+    void fanOut(Fn fn){
+        std::vector<std::future<void>> done;
+        for(std::size_t i=0; i<shards.size(); ++i){
+            done.push_back(workers[i]->submit([this, i, &fn]{ fn(*shards[i], i); }));
+        }
+        std::exception_ptr err;
+        for(auto& d : done){
+            try{
+                d.get();
+            }catch(...){
+                if(!err) err=std::current_exception();
+            }
+        }
+        if(err) std::rethrow_exception(err);
+    }
+
+public:
+    explicit ShardedFileMang(const std::vector<std::string>& paths, const bool logged=true,
+                             const std::chrono::milliseconds interval=std::chrono::seconds(1),
+                             const std::size_t cachedPages=4096){
+        if(paths.empty()) throw UnableToOpenFileException("A sharded file needs at least one shard");
+        for(std::size_t i=0; i<paths.size(); ++i){
+            claim(paths[i], i, paths.size());
+            shards.emplace_back(new FileMang<F>(paths[i], logged, interval, cachedPages));
+            workers.emplace_back(new ThreadPool(1));
+        }
+    }
+
+    ShardedFileMang(const std::string& base, const std::size_t count, const bool logged=true,
+                    const std::chrono::milliseconds interval=std::chrono::seconds(1),
+                    const std::size_t cachedPages=4096):
+    ShardedFileMang(shardPaths(base, count), logged, interval, cachedPages) {}
+
+    ShardedFileMang(const ShardedFileMang&)=delete;
+    ShardedFileMang& operator=(const ShardedFileMang&)=delete;
+
+    // base.0 .. base.<count-1>
+    static std::vector<std::string> shardPaths(const std::string& base, const std::size_t count){
+        std::vector<std::string> paths;
+        for(std::size_t i=0; i<count; ++i) paths.push_back(base+"."+std::to_string(i));
+        return paths;
+    }
+
+    // Fixed mix of the SIN, so placement does not depend on the library's hash.
+    std::size_t shardOf(const long sin) const{
+        std::uint64_t h=static_cast<std::uint64_t>(sin)+0x9e3779b97f4a7c15ULL;
+        h=(h^(h>>30))*0xbf58476d1ce4e5b9ULL;
+        h=(h^(h>>27))*0x94d049bb133111ebULL;
+        h^=h>>31;
+        return static_cast<std::size_t>(h%shards.size());
+    }
+
+    std::size_t shardCount() const{
+        return shards.size();
+    }
+
+    FileMang<F>& shard(const std::size_t i){
+        return *shards[i];
+    }
+
+    bool get(const long sin, F& rec){
+        return shards[shardOf(sin)]->get(sin, rec);
+    }
+
+    bool insert(F& rec){
+        return shards[shardOf(rec.getSIN())]->insert(rec);
+    }
+
+    bool update(F& rec){
+        return shards[shardOf(rec.getSIN())]->update(rec);
+    }
+
+    bool erase(const long sin){
+        return shards[shardOf(sin)]->erase(sin);
+    }
+
+    // recs[i] receives sins[i] where found[i] is set; each shard reads its
+    // share of the batch on its own worker.
+    std::vector<bool> getMany(const std::vector<long>& sins, std::vector<F>& recs){
+        recs.resize(sins.size());
+        std::vector<std::vector<std::size_t>> mine(shards.size());
+        for(std::size_t i=0; i<sins.size(); ++i) mine[shardOf(sins[i])].push_back(i);
+        std::vector<char> hit(sins.size(), 0);
+        fanOut([&](FileMang<F>& s, const std::size_t shard){
+            for(const std::size_t i : mine[shard]) hit[i]=s.get(sins[i], recs[i]);
+        });
+        return std::vector<bool>(hit.begin(), hit.end());
+    }
+
+    // Inserts each shard's share of recs on its worker, so the shards' logs
+    // sync in parallel. Returns how many were new.
+    std::size_t insertMany(std::vector<F>& recs){
+        std::vector<std::vector<std::size_t>> mine(shards.size());
+        for(std::size_t i=0; i<recs.size(); ++i) mine[shardOf(recs[i].getSIN())].push_back(i);
+        std::vector<std::size_t> added(shards.size(), 0);
+        fanOut([&](FileMang<F>& s, const std::size_t shard){
+            for(const std::size_t i : mine[shard]) added[shard]+=s.insert(recs[i]);
+        });
+        std::size_t total=0;
+        for(const std::size_t n : added) total+=n;
+        return total;
+    }
+
+    // fn(FileMang<F>&, shard index) on every shard at once, one worker each.
+    template<typename Fn>
+    void forEachShard(Fn fn){
+        fanOut(fn);
+    }
+
+    void flush(){
+        fanOut([](FileMang<F>& s, std::size_t){ s.flush(); });
+    }
+
+    std::size_t count() const{
+        std::size_t total=0;
+        for(const auto& s : shards) total+=s->count();
+        return total;
+    }
+};
+
+// parallelScan over every shard at once: each shard is quiesced and scanned on
+// the pool while the others are, and the partial results are merged in shard
+// order. Each shard is a consistent image; the set as a whole is not a single
+// point in time.
+template<typename Acc, typename Fold, typename Merge>
+Acc parallelScan(ShardedFileMang<Person>& db, ThreadPool& pool, Fold fold, Merge merge,
+                 const ScanOptions& opt=ScanOptions(), ScanStats* stats=nullptr){
+    std::vector<Acc> parts(db.shardCount());
+    std::vector<ScanStats> partStats(db.shardCount());
+    db.forEachShard([&](FileMang<Person>& s, const std::size_t i){
+        parts[i]=parallelScan<Acc>(s, pool, fold, merge, opt, &partStats[i]);
+    });
+    Acc res{};
+    for(std::size_t i=0; i<parts.size(); ++i){
+        merge(res, std::move(parts[i]));
+        if(stats){
+            stats->records+=partStats[i].records;
+            stats->bytes+=partStats[i].bytes;
+            stats->chunks+=partStats[i].chunks;
+        }
+    }
+    return res;
+}
+
+template<typename Pred>
+SalaryGroups aggregateSalary(ShardedFileMang<Person>& db, ThreadPool& pool, const GroupBy by, Pred pred,
+                             const ScanOptions& opt=ScanOptions(), ScanStats* stats=nullptr){
+    auto fold=[by, &pred](SalaryGroups& acc, const PersonView& r){
+        if(!r.isRemoved() && pred(r)) addToGroup(acc, by, r);
+    };
+    auto merge=[](SalaryGroups& into, SalaryGroups&& part){
+        for(const auto& g : part) into[g.first].merge(g.second);
+    };
+    return parallelScan<SalaryGroups>(db, pool, fold, merge, opt, stats);
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef _WORKLOADGEN_H_
+#define _WORKLOADGEN_H_
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "Person.hpp"
+#include "FileMang.hpp"
+
+namespace workload{
+
+constexpr long firstSIN=100000000;
+
+inline long sinOf(const std::uint64_t i){
+    return firstSIN+static_cast<long>(i);
+}
+
+inline const char* pick(const char* const* pool, const std::size_t n, std::mt19937_64& rng){
+    return pool[rng()%n];
+}
+
+inline Person makePerson(const long sin, std::mt19937_64& rng){
+    static const char* const fnames[]={"Ali", "Hasan", "Jasom", "Mari", "Sara", "Reza", "Nima", "Leila",
+                                       "Omid", "Zahra", "John", "Anna", "Peter", "Maryam", "Kian", "Elena"};
+    static const char* const lnames[]={"Ahmadi", "Hasani", "Tanberland", "Karimi", "Rezaei", "Moradi",
+                                       "Smith", "Jafari", "Novak", "Sadeghi", "Brown", "Tehrani"};
+    static const char* const cities[]={"Tehran", "Hasan Abad", "Yazd", "Ahvaz", "LA", "Shiraz", "Tabriz",
+                                       "Toronto", "Mashhad", "Isfahan", "Montreal", "Kerman"};
+    const std::string sinStr=std::to_string(sin);
+    const int year=1950+static_cast<int>(rng()%55);
+    const long salary=20000+static_cast<long>(rng()%180000);
+    return Person(sinStr.c_str(), pick(fnames, sizeof(fnames)/sizeof(*fnames), rng),
+                  pick(lnames, sizeof(lnames)/sizeof(*lnames), rng),
+                  pick(cities, sizeof(cities)/sizeof(*cities), rng), year, salary);
+}
+
+// Writes n records with SINs sinOf(0) .. sinOf(n-1) in the on-disk Person format.
+inline void generatePersonFile(const std::string& path, const std::uint64_t n, const std::uint64_t seed=1){
+    std::fstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if(!out.is_open()) throw UnableToOpenFileException("Unable to create "+path);
+    std::mt19937_64 rng(seed);
+    for(std::uint64_t i=0; i<n; ++i){
+        Person p=makePerson(sinOf(i), rng);
+        p.writeToFile(out);
+    }
+}
+
+enum class Op{ Get, Update, Insert, Delete, ReadModifyWrite, Count };
+
+inline const char* opName(const Op op){
+    switch(op){
+        case Op::Get: return "get";
+        case Op::Update: return "update";
+        case Op::Insert: return "insert";
+        case Op::Delete: return "delete";
+        case Op::ReadModifyWrite: return "rmw";
+        default: return "?";
+    }
+}
+
+// YCSB core workloads expressed with the operations FileMang supports. FileMang
+// has no range scan, so E (scan-heavy in YCSB) is an insert/delete churn mix.
+struct Mix{
+    char name;
+    int pct[static_cast<int>(Op::Count)];
+    bool latest;
+};
+
+inline bool ycsbMix(const char w, Mix& mix){
+    switch(w){
+        case 'A': mix=Mix{'A', {50, 50, 0, 0, 0}, false}; return true;
+        case 'B': mix=Mix{'B', {95, 5, 0, 0, 0}, false}; return true;
+        case 'C': mix=Mix{'C', {100, 0, 0, 0, 0}, false}; return true;
+        case 'D': mix=Mix{'D', {95, 0, 5, 0, 0}, true}; return true;
+        case 'E': mix=Mix{'E', {50, 0, 25, 25, 0}, false}; return true;
+        case 'F': mix=Mix{'F', {50, 0, 0, 0, 50}, false}; return true;
+    }
+    return false;
+}
+
+template<typename R>
+Op chooseOp(const Mix& mix, R& rng){
+    int dice=static_cast<int>(rng()%100);
+    for(int i=0; i<static_cast<int>(Op::Count); ++i){
+        if(dice<mix.pct[i]) return static_cast<Op>(i);
+        dice-=mix.pct[i];
+    }
+    return Op::Get;
+}
+
+}
+
+#endif
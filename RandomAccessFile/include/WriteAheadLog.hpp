@@ -0,0 +1,210 @@
+#ifndef _WRITEAHEADLOG_H_
+#define _WRITEAHEADLOG_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+class WalException: public std::exception{
+    std::string msg;
+public:
+    WalException(std::string message="Write-ahead log failure"): msg(std::move(message)) {}
+    virtual const char* what() const noexcept override { return msg.c_str();}
+};
+
+struct WalStats{
+    std::uint64_t records=0;
+    std::uint64_t batches=0;
+    std::uint64_t bytes=0;
+};
+
+// Append-only redo log of physical writes (offset + bytes). Writers append
+// under the log mutex and then wait in commit(); whoever finds no flush in
+// progress becomes the leader, writes every pending record and issues one
+// fdatasync for the whole batch. A failed write or sync leaves the log
+// failed: what reached the disk is unknown, so every later commit throws
+// rather than report those LSNs durable.
+class WriteAheadLog{
+public:
+    enum RecordType: std::uint32_t { Write=1, Truncate=2 };
+
+private:
+    struct Header{
+        std::uint32_t length;
+        std::uint32_t checksum;
+        std::uint32_t type;
+        std::uint32_t reserved;
+        std::uint64_t lsn;
+        std::int64_t pos;
+    };
+
+    std::string path;
+    int fd;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<char> pending;
+    std::uint64_t nextLsn;
+    std::uint64_t flushedLsn;
+    bool flushing;
+    std::string failure;
+    WalStats stats;
+
+    static std::uint32_t checksum(const Header& h, const char* data){
+        std::uint32_t sum=2166136261u;
+        auto mix=[&sum](const char* p, const std::size_t n){
+            for(std::size_t i=0; i<n; ++i){
+                sum^=static_cast<unsigned char>(p[i]);
+                sum*=16777619u;
+            }
+        };
+        Header copy=h;
+        copy.checksum=0;
+        mix(reinterpret_cast<const char*>(&copy), sizeof(copy));
+        mix(data, h.length);
+        return sum;
+    }
+
+    void writeFully(const char* data, std::size_t n){
+        while(n){
+            const ssize_t w=::write(fd, data, n);
+            if(w<0){
+                if(errno==EINTR) continue;
+                throw WalException("Unable to write "+path);
+            }
+            data+=w;
+            n-=static_cast<std::size_t>(w);
+        }
+    }
+
+public:
+    explicit WriteAheadLog(std::string file): path{std::move(file)}, nextLsn{1}, flushedLsn{0}, flushing{false} {
+        fd=::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if(fd<0) throw WalException("Unable to open "+path);
+    }
+
+    ~WriteAheadLog(){
+        if(fd>=0) ::close(fd);
+    }
+
+    WriteAheadLog(const WriteAheadLog&)=delete;
+    WriteAheadLog& operator=(const WriteAheadLog&)=delete;
+
+    std::uint64_t append(const long pos, const char* data, const std::size_t len, const RecordType type=Write){
+        std::lock_guard<std::mutex> lock{mtx};
+        Header h{static_cast<std::uint32_t>(len), 0, type, 0, nextLsn++, pos};
+        h.checksum=checksum(h, data);
+        const char* hp=reinterpret_cast<const char*>(&h);
+        pending.insert(pending.end(), hp, hp+sizeof(h));
+        pending.insert(pending.end(), data, data+len);
+        ++stats.records;
+        return h.lsn;
+    }
+
+    void commit(const std::uint64_t lsn){
+        std::unique_lock<std::mutex> lock{mtx};
+        while(flushedLsn<lsn){
+            if(!failure.empty()) throw WalException(failure);
+            if(flushing){
+                cv.wait(lock);
+                continue;
+            }
+            flushing=true;
+            std::vector<char> batch;
+            batch.swap(pending);
+            const std::uint64_t batchLsn=nextLsn-1;
+            lock.unlock();
+            try{
+                writeFully(batch.data(), batch.size());
+                if(::fdatasync(fd)!=0) throw WalException("Unable to sync "+path);
+            }catch(WalException& ex){
+                lock.lock();
+                failure=ex.what();
+                flushing=false;
+                cv.notify_all();
+                throw;
+            }
+            lock.lock();
+            flushing=false;
+            flushedLsn=batchLsn;
+            ++stats.batches;
+            stats.bytes+=batch.size();
+            cv.notify_all();
+        }
+    }
+
+    void commitAll(){
+        std::uint64_t last;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            last=nextLsn-1;
+        }
+        commit(last);
+    }
+
+    std::uint64_t durableLsn(){
+        std::lock_guard<std::mutex> lock{mtx};
+        return flushedLsn;
+    }
+
+    // Calls fn(type, pos, data, len) for every intact record in LSN order and
+    // stops at the first torn or stale one. Returns the number replayed.
+    template<typename Func>
+    std::uint64_t replay(Func fn){
+        std::lock_guard<std::mutex> lock{mtx};
+        const off_t end=::lseek(fd, 0, SEEK_END);
+        std::vector<char> log(static_cast<std::size_t>(end>0? end : 0));
+        std::size_t got=0;
+        while(got<log.size()){
+            const ssize_t r=::pread(fd, log.data()+got, log.size()-got, static_cast<off_t>(got));
+            if(r<0 && errno==EINTR) continue;
+            if(r<=0) break;
+            got+=static_cast<std::size_t>(r);
+        }
+
+        std::uint64_t count=0, lastLsn=0;
+        std::size_t off=0;
+        while(off+sizeof(Header)<=got){
+            Header h;
+            std::memcpy(&h, log.data()+off, sizeof(h));
+            if(off+sizeof(h)+h.length>got) break;
+            const char* data=log.data()+off+sizeof(h);
+            if(h.lsn<=lastLsn || checksum(h, data)!=h.checksum) break;
+            fn(static_cast<RecordType>(h.type), static_cast<long>(h.pos), data, static_cast<std::size_t>(h.length));
+            lastLsn=h.lsn;
+            off+=sizeof(h)+h.length;
+            ++count;
+        }
+        if(lastLsn>=nextLsn) nextLsn=lastLsn+1;
+        flushedLsn=nextLsn-1;
+        return count;
+    }
+
+    // Drops the log contents; only valid once every logged write is durable in
+    // the data file. LSNs keep increasing across resets.
+    void reset(){
+        std::lock_guard<std::mutex> lock{mtx};
+        if(::ftruncate(fd, 0)!=0 || ::fdatasync(fd)!=0) throw WalException("Unable to truncate "+path);
+        pending.clear();
+        flushedLsn=nextLsn-1;
+    }
+
+    std::uint64_t size(){
+        std::lock_guard<std::mutex> lock{mtx};
+        const off_t end=::lseek(fd, 0, SEEK_END);
+        return static_cast<std::uint64_t>(end>0? end : 0)+pending.size();
+    }
+
+    WalStats getStats(){
+        std::lock_guard<std::mutex> lock{mtx};
+        return stats;
+    }
+};
+
+#endif
@@ -7,295 +7,12 @@
 #include <chrono>
 #include <functional>
 #include <map>
+#include <set>
+#include <limits>
+#include <random>
+#include <iterator>
 
-template<typename K, typename V>
-class SkipSet;
-
-template<typename K, typename V, typename H=std::hash<K>>
-class ThreadSafeMapSS{
-private:
-    struct Bucket{
-        SkipSet<K, V> bucket_data;
-
-        std::shared_ptr<V> find(const K& k) const{
-            return bucket_data.find(k);
-        }
-
-        void add_or_update(const K& k, const V& v){
-            V old;
-            if(bucket_data.find(k, old)){
-                bucket_data.update(std::pair<K, V>(k, old), std::pair<K, V>(k, v));
-            }else{
-                bucket_data.add(std::pair<K, V>(k, v));
-            }
-        }
-
-        std::shared_ptr<V> remove(const K& k){
-            return bucket_data.remove(k);
-        }
-
-        std::ostream& print(std::ostream& out) const{
-            out << bucket_data;
-            return out;
-        }
-
-        friend std::ostream& operator<<(std::ostream& out, const Bucket& bucket){
-            return bucket.print(out);
-        }
-    };
-    std::vector<std::unique_ptr<Bucket>> buckets;
-    H hasher;
-
-    Bucket& getBucket(const K& k) const{
-        std::size_t ind{hasher(k)%buckets.size()};
-        return *buckets[ind];
-    }
-
-    std::ostream& print(std::ostream& out) const{
-        for(int i=0; i<buckets.size(); out << *buckets[i], ++i);
-        return out;
-    }
-
-    friend std::ostream& operator<<(std::ostream& out, const ThreadSafeMapSS& tsm){
-        return tsm.print(out);
-    }
-
-public:
-    ThreadSafeMapSS(unsigned int numBuckets = 7, const H& hasher_=H()): buckets(numBuckets), hasher{hasher_} {
-        for(int i{0}; i<numBuckets; ++i){
-            buckets[i].reset(new Bucket);
-        }
-    }
-
-    void add_or_update(const K& k, const V& v){
-        getBucket(k).add_or_update(k, v);
-    }
-
-    std::shared_ptr<V> remove(const K& k){
-        return getBucket(k).remove(k);
-    }
-
-    std::shared_ptr<V> find(const K& k) const{
-        return getBucket(k).find(k);
-    }
-    
-};
-
-template<typename K, typename V>
-class SkipSet{
-    typedef typename std::pair<K, V> T;
-    struct Node{
-        T info;
-        std::vector<Node*> next;
-        int height;
-
-        Node(const T& t, const int hv): info{t}, height{hv} {
-            for(unsigned int i=0; i<=hv; next.push_back(nullptr), ++i);
-        }
-
-    };
-    Node *root;
-    int h;
-    int n;
-    mutable std::shared_timed_mutex mtx;
-
-    void destroySet();
-
-    const int setHeight() const{
-        const int z=std::rand();
-        int m=1;
-        int k=0;
-        while((m & z)){
-            k++;
-            m<<=1;
-        }
-        return k;
-    }
-
-    void updateParams(Node* &curr, Node* &prev, const int r, const T& t) const;
-    bool findEntry(const K& k, V& v) const;
-    bool removeEntry(const K& k, V& v);
-
-    std::ostream& printSS(std::ostream& out) const;
-    friend std::ostream& operator<<(std::ostream& out, const SkipSet& ss){
-        return ss.printSS(out);
-    }
-
-
-public:
-    SkipSet(): n{0}{
-        if constexpr (std::is_same_v<K,std::string> && std::is_same_v<V,std::string>){
-            root=new Node(std::pair<K,V>("", ""), sizeof(int)*8);
-        }else if constexpr (!std::is_same_v<K, std::string> && std::is_same_v<V, std::string>){
-            root=new Node(std::pair<K,V>(static_cast<K>(NULL), ""), sizeof(int)*8);
-        }else if constexpr (std::is_same_v<K, std::string> && !std::is_same_v<V, std::string>){
-            root=new Node(std::pair<K,V>( "", static_cast<V>(NULL)), sizeof(int)*8);
-        }else{
-            root=new Node(std::pair<K,V>(static_cast<K>(NULL), static_cast<V>(NULL)), sizeof(int)*8);
-        }
-        h=root->height;
-    }
-
-    ~SkipSet(){
-        destroySet();
-    }
-
-    void add(const T& t);
-    bool update(const T& old, const T& t);
-
-    std::shared_ptr<V> find(const K& k) const{
-        V v;
-        return findEntry(k, v)? std::make_shared<V>(std::move(v)) : std::make_shared<V>();
-    }
-
-    bool find(const K& k, V& v) const{
-        return findEntry(k, v);
-    }
-
-    bool remove(const K& k, V& v){
-        return removeEntry(k, v);
-    }
-
-    std::shared_ptr<V> remove(const K& k){
-        V v;
-        return removeEntry(k, v)? std::make_shared<V>(std::move(v)) : std::make_shared<V>();
-    }
-
-    std::map<K, V> getMap() const{
-        std::unique_lock<std::shared_timed_mutex> lock{mtx};
-        std::map<K, V> res;
-        for(Node* node=root->next[0]; node; res.insert(node->info.first, node->info.second), node=node->next[0]);
-        return res;
-    }
-    
-};
-
-template<typename K, typename V>
-bool SkipSet<K, V>::update(const T& old, const T& t){
-
-    if(old.first != t.first) {
-        return false;
-    }else{
-        if(old.second == t.second) return false;
-    }
-
-    
-    Node* curr=root, *prev=nullptr;
-    std::unique_lock<std::shared_timed_mutex> lock{mtx};
-    int r=h;
-    while(r>=0){
-        updateParams(curr, prev, r, old);
-        if(curr->next[r] && curr->next[r]->info.first==old.first){
-            lock.unlock();
-            V v;
-            remove(old.first, v);
-            add(t);
-            return true;
-        }
-        r--;
-    }
-    return false;
-}
-
-template<typename K, typename V>
-bool SkipSet<K, V>::removeEntry(const K& k, V& v){
-    Node* curr=root, *prev=nullptr, *del=nullptr;
-    std::unique_lock<std::shared_timed_mutex> lock{mtx};
-    int r=h;
-    while(r>=0){
-        updateParams(curr, prev, r, std::pair<K, V>(k, v));
-        if(curr->next[r] && curr->next[r]->info.first==k){
-            del=curr->next[r];
-            curr->next[r]=del->next[r];
-            if(curr==root) h--;
-        }
-        r--;
-    }
-    if(del){
-        v=del->info.second;
-        delete del;
-        n--;
-        return true;
-    }
-    return false;
-
-}
-
-template<typename K, typename V>
-bool SkipSet<K, V>:: findEntry(const K& k, V& v) const{
-    Node* curr=root, *prev=nullptr;
-    
-    std::lock_guard<std::shared_timed_mutex> lock{mtx};
-
-    int r=h;
-    while(r>=0){
-        updateParams(curr, prev, r, std::pair<K, V>(k, v));
-        if(curr->next[r] && curr->next[r]->info.first==k){
-            v=curr->next[r]->info.second;
-            return true;
-        }
-        r--;
-    }
-    return false;
-}
-
-template<typename K, typename V>
-std::ostream& SkipSet<K, V>::printSS(std::ostream& out) const{
-    std::lock_guard<std::shared_timed_mutex> lock{mtx};
-    for(Node* node=root->next[0]; node; node=node->next[0]){
-        out << "(" << node->info.first << ", " << node->info.second << ")" << "    ";
-    }
-    out << "\n";
-    return out;
-}
-
-template<typename K, typename V>
-void SkipSet<K, V>::updateParams(Node* &curr, Node* &prev, const int r, const T& t) const{
-    while(curr->next[r] && (!prev || (prev && prev!=curr)) && curr->next[r]->info.first < t.first){
-        prev=curr;
-        curr=curr->next[r];
-    }
-}
-
-template<typename K, typename V>
-void SkipSet<K, V>::add(const T& t){
-    Node* curr=root, *prev=nullptr;
-    Node* node=new Node(std::pair<K, V>(t.first, t.second), setHeight());
-    std::vector<Node*> finger;
-
-    {
-        std::unique_lock<std::shared_timed_mutex> lock{mtx};
-        for(unsigned int i=0; i<=h; finger.push_back(nullptr), ++i);
-        int r=h;
-        while(r>=0){
-            updateParams(curr, prev, r, t);
-            if(curr->next[r] && curr->next[r]->info.first == t.first) return;
-            finger[r--]=curr;
-        }
-        while(node->height >= h++){
-            finger.push_back(root);
-        }
-
-        for(unsigned int i=0; i<=node->height; ++i){
-            node->next[i]=finger[i]->next[i];
-            finger[i]->next[i]=node;
-        }
-        n++;
-    }
-}
-
-template<typename K, typename V>
-void SkipSet<K, V>::destroySet(){
-    std::unique_lock<std::shared_timed_mutex> lock{mtx};
-    Node* curr=root;
-    while(curr){
-        Node* tmp=curr->next[0];
-        delete curr;
-        curr=tmp;
-        n--;
-    }
-    h=0;
-}
+#include "include/ThreadSafeMapSS.hpp"
 
 void testSS(){
     SkipSet<int, int> ss1;
@@ -459,6 +176,89 @@ void testMap(){
     }
 
     std::cout << tsm;
+#ifdef THREADSAFE_STATS
+    std::cout << tsm.stats().toJson() << "\n";
+#endif
+}
+
+// Checks the integer SkipSet against std::set around its group boundaries:
+// a node holds one cache line of keys (16 ints, 8 longs), splits in half when
+// a key lands in a full group, packs appends densely and is unlinked once its
+// last key goes. Every key of the reference and both neighbours of it are
+// looked up after each phase, so a wrong rank (AVX2 for int and long, the
+// scalar loop for unsigned) shows up as a missed or phantom key.
+template<typename K>
+bool checkAgainstSet(const SkipSet<K, K>& ss, const std::set<K>& ref){
+    for(const K k : ref){
+        K v;
+        if(!ss.find(k, v) || v!=k) return false;
+        if(k!=std::numeric_limits<K>::min() && !ref.count(k-1) && ss.find(k-1, v)) return false;
+        if(k!=std::numeric_limits<K>::max() && !ref.count(k+1) && ss.find(k+1, v)) return false;
+    }
+    std::map<K, K> got=ss.getMap();
+    if(got.size()!=ref.size() || static_cast<std::size_t>(ss.size())!=ref.size()) return false;
+    auto it=ref.begin();
+    for(auto& p : got){
+        if(p.first!=*it++ || p.second!=p.first) return false;
+    }
+    if(ref.empty()) return true;
+    const K lo=*std::next(ref.begin(), ref.size()/3);
+    const K hi=*std::next(ref.begin(), 2*ref.size()/3);
+    std::vector<K> range;
+    ss.forRange(lo, hi, [&range](const K k, const K){ range.push_back(k); });
+    return range==std::vector<K>(ref.lower_bound(lo), ref.upper_bound(hi));
+}
+
+template<typename K>
+bool testUnrolledSS(const char* name){
+    const K group=static_cast<K>(64/sizeof(K));
+    SkipSet<K, K> ss;
+    std::set<K> ref;
+    auto add=[&](const K k){
+        ss.add(std::pair<K, K>(k, k));
+        ref.insert(k);
+    };
+    auto remove=[&](const K k){
+        K v;
+        const bool removed=ss.remove(k, v);
+        return removed==(ref.erase(k)>0) && (!removed || v==k);
+    };
+    bool ok=true;
+
+    // Appends in order fill each group before starting the next.
+    for(K k=0; k<5*group; ++k) add(k*4);
+    ok=ok && checkAgainstSet(ss, ref);
+    // Keys between them land in full groups and split them mid-way.
+    for(K k=0; k<5*group; k+=3) add(k*4+2);
+    ok=ok && checkAgainstSet(ss, ref);
+    // First keys of groups go through the head-of-group path.
+    for(K k=0; k<5*group; k+=group) ok=ok && remove(k*4);
+    ok=ok && checkAgainstSet(ss, ref);
+    // Emptying a stretch unlinks whole groups.
+    for(K k=group; k<3*group; ++k){
+        ok=ok && remove(k*4);
+        ok=ok && remove(k*4+2);
+    }
+    ok=ok && checkAgainstSet(ss, ref);
+    // The extremes: max is also the padding value of a group.
+    const K edges[]={std::numeric_limits<K>::min(), static_cast<K>(std::numeric_limits<K>::min()+1),
+                     static_cast<K>(std::numeric_limits<K>::max()-1), std::numeric_limits<K>::max()};
+    for(const K k : edges) add(k);
+    ok=ok && checkAgainstSet(ss, ref);
+    // Random churn in a narrow range forces splits and unlinks back to back.
+    std::mt19937_64 rng(7);
+    for(int i=0; i<20000 && ok; ++i){
+        const K k=static_cast<K>(rng()%(6*group));
+        if(rng()%3) add(k);
+        else ok=remove(k);
+        if(i%1000==0) ok=ok && checkAgainstSet(ss, ref);
+    }
+    for(const K k : edges) ok=ok && remove(k);
+    ok=ok && checkAgainstSet(ss, ref);
+
+    std::cout << "unrolled SkipSet<" << name << ">: " << ref.size() << " keys, " << (ok? "matches" : "DIFFERS from")
+              << " std::set\n";
+    return ok;
 }
 
 int main(){
@@ -472,5 +272,7 @@ int main(){
 
     testMap();
 
-    return 0;
+    const bool ok=testUnrolledSS<int>("int") && testUnrolledSS<long>("long")
+                  && testUnrolledSS<unsigned int>("unsigned int");
+    return ok? 0 : 1;
 }
\ No newline at end of file
@@ -5,111 +5,7 @@
 #include <memory>
 #include <vector>
 
-template<typename T>
-class ThreadSafeSorteList{
-    struct Node{
-        std::shared_ptr<T> data;
-        std::unique_ptr<Node> next;
-        std::mutex mtx;
-
-        Node(): next() {}
-        Node(T t): data{std::make_shared<T>(std::move(t))} {}
-    };
-    Node head;
-    int n;
-
-    std::ostream& print(std::ostream& out){
-        forEach([&out](const T& t){
-            out << t << "  ";
-        });
-        out << "\n";
-        return out;
-    }
-
-    friend std::ostream& operator<<(std::ostream& out, ThreadSafeSorteList& tss){
-        return tss.print(out);
-    }
-
-public:
-    ThreadSafeSorteList(): n{0} {}
-
-    void add(T t){
-        std::unique_ptr<Node> newNode{new Node(t)};
-        std::unique_lock<std::mutex> lock{head.mtx};
-        if(!n++){
-            head.next=std::move(newNode);
-        }
-
-        Node* curr=&head;
-        while(Node* node=curr->next.get()){
-            if(*(node->data) > t){
-                std::unique_lock<std::mutex> nxtLock{node->mtx};
-                lock.unlock();
-                Node* p=newNode.get();
-                p->next=std::move(curr->next);
-                curr->next=std::move(newNode);
-                n++;
-                break;
-            }
-            curr=node;
-        }
-    }
-
-    bool remove(const T& t){
-        std::unique_lock<std::mutex> lock{head.mtx};
-        if(!n) return false;
-        Node* curr=&head;
-        bool removed{false};
-        while(Node* node=curr->next.get()){
-            std::unique_lock<std::mutex> nxtLock{node->mtx};
-            if(*node->data < t){
-                lock.unlock();
-                curr=node;
-                lock=std::move(nxtLock);
-            }else if(*node->data == t){
-                std::unique_ptr<Node> oldNode{std::move(curr->next)};
-                curr->next=std::move(node->next);
-                nxtLock.unlock();
-                removed=true;
-            }else{
-                break;
-            }
-        }
-        return removed;
-    }
-
-    bool find(const T& t){
-        std::unique_lock<std::mutex> lock{head.mtx};
-        if(!n) return false;
-        Node* curr=&head;
-        while(Node* node=curr->next.get()){
-            std::unique_lock<std::mutex> nxtLock{node->mtx};
-            lock.unlock();
-            if(*node->data < t){
-               curr=node;
-               lock=std::move(nxtLock); 
-            }else if(*node->data==t){
-                return true;
-            }else {
-                break;
-            }
-        }
-        return false;
-    }
-
-    template<typename Func>
-    void forEach(Func func){
-        Node* curr=&head;
-        std::unique_lock<std::mutex> lock{head.mtx};
-        while(Node* node=curr->next.get()){
-            std::unique_lock<std::mutex> nxtLock{node->mtx};
-            lock.unlock();
-            func(*node->data);
-            curr=node;
-            lock=std::move(nxtLock);
-        }
-    }
-};
+#include "include/ThreadSafeSortList.hpp"
 
 int main(){
     ThreadSafeSorteList<int> tsl;
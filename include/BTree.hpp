@@ -0,0 +1,416 @@
+#ifndef _BTREE_H_
+#define _BTREE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "LockStats.hpp"
+#include "ShardedCounter.hpp"
+
+// In-memory B+-tree over integral keys with optimistic lock coupling. Every
+// node carries a version word; readers never write it, they read the node and
+// check the version did not move, restarting from the root if it did. Writers
+// lock only the nodes they change, splitting full inner nodes on the way down
+// so a split never has to climb. Keys and values live inline in 1 KiB nodes,
+// and a split of the rightmost node leaves the left half full, so keys that
+// arrive in order pack densely. Nodes are never merged or freed while the tree
+// lives: a removal only takes the entry out of its leaf.
+template<typename K, typename V>
+class BTree{
+    static_assert(std::is_integral_v<K>, "BTree keys are integers");
+    static_assert(std::is_trivially_copyable_v<V> && std::atomic<V>::is_always_lock_free,
+                  "BTree values are read optimistically and must be lock-free atomics");
+
+    static constexpr std::size_t nodeBytes=1024;
+
+    // Version word: bit 1 set while write-locked; unlock adds 2 more, which
+    // clears it and moves the version on.
+    struct alignas(64) Node{
+        std::atomic<std::uint64_t> version;
+        std::atomic<std::uint32_t> count;
+        const bool leaf;
+
+        explicit Node(const bool isLeaf): version{0b100}, count{0}, leaf{isLeaf} {}
+
+        bool readLock(std::uint64_t& v) const{
+            v=version.load(std::memory_order_acquire);
+            return !(v & 0b10);
+        }
+
+        bool validate(const std::uint64_t v) const{
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return version.load(std::memory_order_relaxed)==v;
+        }
+
+        bool upgrade(std::uint64_t& v){
+            if(!version.compare_exchange_strong(v, v+0b10, std::memory_order_acquire)) return false;
+            std::atomic_thread_fence(std::memory_order_release);
+            v+=0b10;
+            return true;
+        }
+
+        void writeUnlock(){
+            version.fetch_add(0b10, std::memory_order_release);
+        }
+    };
+
+    // Index of the first of the n keys not less than k, without branching on
+    // the comparisons.
+    static std::uint32_t lowerBound(const std::atomic<K>* keys, std::uint32_t n, const K k){
+        std::uint32_t first=0;
+        while(n){
+            const std::uint32_t half=n>>1;
+            const bool less=keys[first+half].load(std::memory_order_relaxed)<k;
+            first= less? first+half+1 : first;
+            n= less? n-half-1 : half;
+        }
+        return first;
+    }
+
+    struct Leaf: Node{
+        static constexpr std::uint32_t capacity=(nodeBytes-sizeof(Node))/(sizeof(K)+sizeof(V));
+        std::atomic<K> keys[capacity]{};
+        std::atomic<V> values[capacity]{};
+
+        Leaf(): Node(true) {}
+
+        std::uint32_t size() const{
+            return std::min(this->count.load(std::memory_order_relaxed), capacity);
+        }
+
+        bool find(const K k, std::uint32_t& pos) const{
+            const std::uint32_t n=size();
+            pos=lowerBound(keys, n, k);
+            return pos<n && keys[pos].load(std::memory_order_relaxed)==k;
+        }
+
+        void insertAt(const std::uint32_t pos, const K k, const V v){
+            const std::uint32_t n=size();
+            for(std::uint32_t i=n; i>pos; --i){
+                keys[i].store(keys[i-1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                values[i].store(values[i-1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            keys[pos].store(k, std::memory_order_relaxed);
+            values[pos].store(v, std::memory_order_relaxed);
+            this->count.store(n+1, std::memory_order_relaxed);
+        }
+
+        void eraseAt(const std::uint32_t pos){
+            const std::uint32_t n=size();
+            for(std::uint32_t i=pos; i+1<n; ++i){
+                keys[i].store(keys[i+1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                values[i].store(values[i+1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            this->count.store(n-1, std::memory_order_relaxed);
+        }
+
+        // Moves the upper entries to a new right sibling and returns it; sep
+        // is the largest key left behind. An append keeps this node full.
+        Leaf* split(K& sep, const bool append){
+            const std::uint32_t n=size();
+            const std::uint32_t keep= append? n : n/2;
+            Leaf* right=new Leaf;
+            for(std::uint32_t i=keep; i<n; ++i){
+                right->keys[i-keep].store(keys[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                right->values[i-keep].store(values[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            right->count.store(n-keep, std::memory_order_relaxed);
+            this->count.store(keep, std::memory_order_relaxed);
+            sep=keys[keep-1].load(std::memory_order_relaxed);
+            return right;
+        }
+    };
+
+    // keys[i] is the largest key under children[i]; the last child has none.
+    struct Inner: Node{
+        static constexpr std::uint32_t capacity=(nodeBytes-sizeof(Node)-sizeof(Node*))/(sizeof(K)+sizeof(Node*));
+        std::atomic<K> keys[capacity]{};
+        std::atomic<Node*> children[capacity+1]{};
+
+        Inner(): Node(false) {}
+
+        std::uint32_t size() const{
+            return std::min(this->count.load(std::memory_order_relaxed), capacity);
+        }
+
+        void insert(const K sep, Node* right){
+            const std::uint32_t n=size();
+            const std::uint32_t pos=lowerBound(keys, n, sep);
+            for(std::uint32_t i=n; i>pos; --i){
+                keys[i].store(keys[i-1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                children[i+1].store(children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            keys[pos].store(sep, std::memory_order_relaxed);
+            children[pos+1].store(right, std::memory_order_relaxed);
+            this->count.store(n+1, std::memory_order_relaxed);
+        }
+
+        Inner* split(K& sep, const bool append){
+            const std::uint32_t n=size();
+            const std::uint32_t mid= append? n-1 : n/2;
+            Inner* right=new Inner;
+            for(std::uint32_t i=mid+1; i<n; ++i){
+                right->keys[i-mid-1].store(keys[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            for(std::uint32_t i=mid+1; i<=n; ++i){
+                right->children[i-mid-1].store(children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            right->count.store(n-mid-1, std::memory_order_relaxed);
+            this->count.store(mid, std::memory_order_relaxed);
+            sep=keys[mid].load(std::memory_order_relaxed);
+            return right;
+        }
+    };
+
+    static_assert(sizeof(std::atomic<K>)==sizeof(K) && sizeof(std::atomic<V>)==sizeof(V), "atomics must be unpadded");
+
+    std::atomic<Node*> root;
+    ShardedCounter count;
+    std::atomic<std::size_t> nodes;
+    ContainerStatsSink sink;
+
+    static void backoff(const unsigned int restarts){
+        if(restarts%8==0) std::this_thread::yield();
+    }
+
+    void makeRoot(const K sep, Node* left, Node* right){
+        Inner* r=new Inner;
+        r->keys[0].store(sep, std::memory_order_relaxed);
+        r->children[0].store(left, std::memory_order_relaxed);
+        r->children[1].store(right, std::memory_order_relaxed);
+        r->count.store(1, std::memory_order_relaxed);
+        nodes.fetch_add(1, std::memory_order_relaxed);
+        root.store(r, std::memory_order_release);
+    }
+
+    // Read-couples from the root to the leaf that holds k. On success leaf
+    // was read-locked at version, its parent (if any) had not moved since,
+    // and upper, when bounded, is the smallest separator right of the path:
+    // every key in the leaf is at most upper.
+    bool descend(const K k, Leaf*& leaf, std::uint64_t& version, K* upper=nullptr, bool* bounded=nullptr) const{
+        Node* node=root.load(std::memory_order_acquire);
+        if(!node->readLock(version) || node!=root.load(std::memory_order_acquire)) return false;
+        std::uint64_t steps=0;
+        while(!node->leaf){
+            const Inner* inner=static_cast<const Inner*>(node);
+            const std::uint32_t n=inner->size();
+            const std::uint32_t pos=lowerBound(inner->keys, n, k);
+            if(upper && pos<n){
+                *upper=inner->keys[pos].load(std::memory_order_relaxed);
+                *bounded=true;
+            }
+            Node* child=inner->children[pos].load(std::memory_order_relaxed);
+            if(!inner->validate(version)) return false;
+            std::uint64_t childVersion;
+            if(!child->readLock(childVersion) || !inner->validate(version)) return false;
+            node=child;
+            version=childVersion;
+            ++steps;
+        }
+        sink.ops().traversal(steps);
+        leaf=static_cast<Leaf*>(node);
+        return true;
+    }
+
+    bool tryFind(const K k, V& v, bool& found) const{
+        Leaf* leaf;
+        std::uint64_t version;
+        if(!descend(k, leaf, version)) return false;
+        std::uint32_t pos;
+        found=leaf->find(k, pos);
+        if(found) v=leaf->values[pos].load(std::memory_order_relaxed);
+        return leaf->validate(version);
+    }
+
+    bool tryRemove(const K k, V& v, bool& removed){
+        Leaf* leaf;
+        std::uint64_t version;
+        if(!descend(k, leaf, version) || !leaf->upgrade(version)) return false;
+        std::uint32_t pos;
+        removed=leaf->find(k, pos);
+        if(removed){
+            v=leaf->values[pos].load(std::memory_order_relaxed);
+            leaf->eraseAt(pos);
+            count.sub();
+        }
+        leaf->writeUnlock();
+        return true;
+    }
+
+    // Splits node (locked at version, parent locked at parentVersion) and
+    // hangs the new sibling off the parent, or off a new root. Always asks
+    // the caller to restart.
+    template<typename N>
+    bool splitNode(N* node, std::uint64_t& version, Inner* parent, std::uint64_t& parentVersion, const bool append){
+        if(parent && !parent->upgrade(parentVersion)) return false;
+        if(!node->upgrade(version)){
+            if(parent) parent->writeUnlock();
+            return false;
+        }
+        if(!parent && node!=root.load(std::memory_order_acquire)){
+            node->writeUnlock();
+            return false;
+        }
+        K sep;
+        N* right=node->split(sep, append);
+        nodes.fetch_add(1, std::memory_order_relaxed);
+        if(parent) parent->insert(sep, right);
+        else makeRoot(sep, node, right);
+        node->writeUnlock();
+        if(parent) parent->writeUnlock();
+        return false;
+    }
+
+    bool tryInsert(const K k, const V v, bool& added){
+        Node* node=root.load(std::memory_order_acquire);
+        std::uint64_t version;
+        if(!node->readLock(version) || node!=root.load(std::memory_order_acquire)) return false;
+        Inner* parent=nullptr;
+        std::uint64_t parentVersion=0;
+        bool rightmost=true;
+        while(!node->leaf){
+            Inner* inner=static_cast<Inner*>(node);
+            const std::uint32_t n=inner->size();
+            const std::uint32_t pos=lowerBound(inner->keys, n, k);
+            if(n==Inner::capacity) return splitNode(inner, version, parent, parentVersion, rightmost && pos==n);
+            rightmost=rightmost && pos==n;
+            Node* child=inner->children[pos].load(std::memory_order_relaxed);
+            if(!inner->validate(version)) return false;
+            std::uint64_t childVersion;
+            if(!child->readLock(childVersion) || !inner->validate(version)) return false;
+            parent=inner;
+            parentVersion=version;
+            node=child;
+            version=childVersion;
+        }
+
+        Leaf* leaf=static_cast<Leaf*>(node);
+        std::uint32_t pos;
+        const bool present=leaf->find(k, pos);
+        const std::uint32_t n=leaf->size();
+        if(!leaf->validate(version)) return false;
+        if(present){
+            added=false;
+            return true;
+        }
+        if(n==Leaf::capacity) return splitNode(leaf, version, parent, parentVersion, rightmost && pos==n);
+        if(!leaf->upgrade(version)) return false;
+        leaf->insertAt(pos, k, v);
+        leaf->writeUnlock();
+        count.add();
+        added=true;
+        return true;
+    }
+
+    static void destroy(Node* node){
+        if(!node->leaf){
+            Inner* inner=static_cast<Inner*>(node);
+            for(std::uint32_t i=0; i<=inner->size(); ++i) destroy(inner->children[i].load(std::memory_order_relaxed));
+            delete inner;
+        }else{
+            delete static_cast<Leaf*>(node);
+        }
+    }
+
+public:
+    BTree(): root{new Leaf}, nodes{1} {}
+
+    ~BTree(){
+        destroy(root.load(std::memory_order_relaxed));
+    }
+
+    BTree(const BTree&)=delete;
+    BTree& operator=(const BTree&)=delete;
+
+    // Leaves the value alone if k is already there, as SkipSet::add does.
+    bool add(const std::pair<K, V>& t){
+        bool added=false;
+        for(unsigned int restarts=1; !tryInsert(t.first, t.second, added); ++restarts){
+            sink.ops().retry();
+            backoff(restarts);
+        }
+        if(added) sink.ops().push();
+        return added;
+    }
+
+    bool find(const K& k, V& v) const{
+        bool found=false;
+        for(unsigned int restarts=1; !tryFind(k, v, found); ++restarts){
+            sink.ops().retry();
+            backoff(restarts);
+        }
+        return found;
+    }
+
+    bool remove(const K& k, V& v){
+        bool removed=false;
+        for(unsigned int restarts=1; !tryRemove(k, v, removed); ++restarts){
+            sink.ops().retry();
+            backoff(restarts);
+        }
+        if(removed) sink.ops().pop();
+        return removed;
+    }
+
+    bool remove(const K& k){
+        V v;
+        return remove(k, v);
+    }
+
+    // fn(key, value) for every entry in [lo, hi] in key order. Each leaf is
+    // copied out and validated before fn sees it, so fn runs with nothing
+    // locked and sees every entry that stayed in the tree throughout.
+    template<typename Func>
+    void forRange(K lo, const K hi, Func fn) const{
+        std::pair<K, V> batch[Leaf::capacity];
+        while(!(hi<lo)){
+            Leaf* leaf;
+            std::uint64_t version;
+            K upper{};
+            bool bounded=false;
+            std::uint32_t got=0;
+            for(unsigned int restarts=1; ; ++restarts){
+                bounded=false;
+                got=0;
+                if(descend(lo, leaf, version, &upper, &bounded)){
+                    const std::uint32_t n=leaf->size();
+                    for(std::uint32_t i=lowerBound(leaf->keys, n, lo); i<n; ++i){
+                        const K k=leaf->keys[i].load(std::memory_order_relaxed);
+                        if(hi<k) break;
+                        batch[got++]=std::pair<K, V>(k, leaf->values[i].load(std::memory_order_relaxed));
+                    }
+                    if(leaf->validate(version)) break;
+                }
+                sink.ops().retry();
+                backoff(restarts);
+            }
+            for(std::uint32_t i=0; i<got; ++i) fn(batch[i].first, batch[i].second);
+            if(!bounded || !(upper<hi)) return;
+            lo=upper+1;
+        }
+    }
+
+    // Exact once the writers it should count have finished.
+    std::size_t size() const{
+        return count.size();
+    }
+
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    std::size_t bytes() const{
+        return nodes.load(std::memory_order_relaxed)*nodeBytes;
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+};
+
+#endif
@@ -0,0 +1,416 @@
+#ifndef _CORO_H_
+#define _CORO_H_
+
+// Coroutine front end for the containers: tasks, an executor to resume them
+// on, and a bounded queue whose pop and push suspend the coroutine instead of
+// blocking its thread. A waiting coroutine costs its frame, a few hundred
+// bytes, rather than a thread stack. Needs C++20 (-std=c++20); with older
+// standards the header is empty and COROUTINES is left undefined.
+#if defined(__cpp_impl_coroutine)
+#define COROUTINES 1
+
+#include <coroutine>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ThreadSafeQueue.hpp"
+
+// Resumes coroutines handed to post(). With no threads the owner drives it
+// through run() or poll(); otherwise that many workers run it until close().
+class CoroExecutor{
+    ThreadSafeQueue<std::coroutine_handle<>> ready;
+    std::vector<std::thread> workers;
+
+public:
+    explicit CoroExecutor(const unsigned int threads=0){
+        for(unsigned int i=0; i<threads; ++i) workers.emplace_back([this]{ run(); });
+    }
+
+    ~CoroExecutor(){
+        close();
+        for(auto& w : workers){
+            if(w.joinable()) w.join();
+        }
+    }
+
+    CoroExecutor(const CoroExecutor&)=delete;
+    CoroExecutor& operator=(const CoroExecutor&)=delete;
+
+    // Throws QueueClosedException after close().
+    void post(const std::coroutine_handle<> h){
+        ready.push(h);
+    }
+
+    // Resumes on the calling thread until closed and drained.
+    void run(){
+        std::coroutine_handle<> h;
+        while(ready.waitAndDequeue(h)) h.resume();
+    }
+
+    // Resumes what is ready, waiting up to timeout for the first; returns how
+    // many ran.
+    template<typename Rep, typename Period>
+    std::size_t runFor(const std::chrono::duration<Rep, Period>& timeout){
+        std::size_t n=0;
+        std::coroutine_handle<> h;
+        if(!ready.waitFor(h, timeout)) return n;
+        do{
+            h.resume();
+            ++n;
+        }while(ready.tryDequeue(h));
+        return n;
+    }
+
+    std::size_t poll(){
+        return runFor(std::chrono::seconds(0));
+    }
+
+    void close(){
+        if(!ready.isClosed()) ready.close();
+    }
+
+    bool threaded() const{
+        return !workers.empty();
+    }
+
+    // co_await ex.schedule() carries on on one of ex's threads.
+    auto schedule(){
+        struct Awaiter{
+            CoroExecutor& ex;
+            bool await_ready() const noexcept{ return false; }
+            void await_suspend(const std::coroutine_handle<> h){ ex.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+};
+
+template<typename T=void>
+class Task;
+
+namespace coro{
+
+// Tasks start when first awaited (or spawned) and hand control straight back
+// to whoever awaited them when they finish. A spawned task has no awaiter and
+// frees itself; an exception escaping it ends the program, as it would from a
+// std::thread.
+struct PromiseBase{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    bool detached=false;
+
+    struct Final{
+        bool await_ready() const noexcept{ return false; }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<P> h) noexcept{
+            PromiseBase& p=h.promise();
+            if(p.continuation) return p.continuation;
+            if(p.detached){
+                if(p.error) std::terminate();
+                h.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept{ return {}; }
+    Final final_suspend() const noexcept{ return {}; }
+    void unhandled_exception(){ error=std::current_exception(); }
+};
+
+template<typename T>
+struct Promise: PromiseBase{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& v){
+        value.emplace(std::forward<U>(v));
+    }
+
+    T result(){
+        if(error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void>: PromiseBase{
+    Task<void> get_return_object();
+
+    void return_void() const noexcept {}
+
+    void result(){
+        if(error) std::rethrow_exception(error);
+    }
+};
+
+}
+
+template<typename T>
+class Task{
+public:
+    typedef coro::Promise<T> promise_type;
+
+private:
+    std::coroutine_handle<promise_type> h;
+
+public:
+    explicit Task(const std::coroutine_handle<promise_type> handle): h{handle} {}
+    Task(Task&& t) noexcept: h{std::exchange(t.h, nullptr)} {}
+    Task& operator=(Task&& t) noexcept{
+        if(this!=&t){
+            if(h) h.destroy();
+            h=std::exchange(t.h, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&)=delete;
+    Task& operator=(const Task&)=delete;
+
+    ~Task(){
+        if(h) h.destroy();
+    }
+
+    auto operator co_await() &&{
+        struct Awaiter{
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() const noexcept{ return false; }
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept{
+                h.promise().continuation=awaiting;
+                return h;
+            }
+            T await_resume(){ return h.promise().result(); }
+        };
+        return Awaiter{h};
+    }
+
+    // Gives up ownership of the frame; it then frees itself when done.
+    std::coroutine_handle<promise_type> release(){
+        h.promise().detached=true;
+        return std::exchange(h, nullptr);
+    }
+};
+
+namespace coro{
+
+template<typename T>
+Task<T> Promise<T>::get_return_object(){
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object(){
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+}
+
+// Starts t on ex and lets it run to completion on its own.
+inline void spawn(CoroExecutor& ex, Task<void> t){
+    ex.post(t.release());
+}
+
+// Runs t on ex and blocks the calling thread for its result. Without worker
+// threads the calling thread runs ex meanwhile.
+template<typename T>
+T syncWait(CoroExecutor& ex, Task<T> t){
+    std::promise<T> done;
+    std::future<T> res=done.get_future();
+    spawn(ex, [](Task<T> inner, std::promise<T>& out) -> Task<void> {
+        try{
+            if constexpr (std::is_void_v<T>){
+                co_await std::move(inner);
+                out.set_value();
+            }else{
+                out.set_value(co_await std::move(inner));
+            }
+        }catch(...){
+            out.set_exception(std::current_exception());
+        }
+    }(std::move(t), done));
+    if(ex.threaded()){
+        res.wait();
+    }else{
+        while(res.wait_for(std::chrono::seconds(0))!=std::future_status::ready) ex.runFor(std::chrono::milliseconds(1));
+    }
+    return res.get();
+}
+
+// Bounded queue for coroutines. co_await pop() suspends while it is empty and
+// co_await push(v) while it is full; whoever makes room or brings an item
+// hands it over directly and resumes the waiter on the queue's executor, after
+// letting go of the queue, so a resumed waiter may destroy it. Plain threads
+// feed or drain it with tryPush and tryPop. close() works as on the blocking
+// queues: pops carry on until it is empty and then yield nullopt, and pushes
+// return false.
+template<typename T>
+class AsyncQueue{
+    struct PopWaiter{
+        std::coroutine_handle<> h;
+        std::optional<T> value;
+    };
+
+    struct PushWaiter{
+        std::coroutine_handle<> h;
+        T value;
+        bool ok;
+    };
+
+    CoroExecutor& ex;
+    const std::size_t capacity;
+    std::mutex mtx;
+    std::deque<T> items;
+    std::deque<PopWaiter*> poppers;
+    std::deque<PushWaiter*> pushers;
+    bool closed{false};
+
+    // Called with mtx held; takes the oldest item and lets the oldest waiting
+    // push into the room it leaves. That push is handed back in wake for the
+    // caller to post once mtx is released.
+    bool takeLocked(std::optional<T>& out, std::coroutine_handle<>& wake){
+        if(items.empty()) return false;
+        out.emplace(std::move(items.front()));
+        items.pop_front();
+        if(!pushers.empty()){
+            PushWaiter* w=pushers.front();
+            pushers.pop_front();
+            items.push_back(std::move(w->value));
+            w->ok=true;
+            wake=w->h;
+        }
+        return true;
+    }
+
+    // Called with mtx held; false when full or closed. A pop that got v
+    // directly is handed back in wake.
+    bool putLocked(T& v, std::coroutine_handle<>& wake){
+        if(closed) return false;
+        if(!poppers.empty()){
+            PopWaiter* w=poppers.front();
+            poppers.pop_front();
+            w->value.emplace(std::move(v));
+            wake=w->h;
+            return true;
+        }
+        if(items.size()>=capacity) return false;
+        items.push_back(std::move(v));
+        return true;
+    }
+
+    void wakeUp(const std::coroutine_handle<> wake){
+        if(wake) ex.post(wake);
+    }
+
+public:
+    AsyncQueue(CoroExecutor& executor, const std::size_t cap): ex{executor}, capacity{cap? cap : 1} {}
+
+    AsyncQueue(const AsyncQueue&)=delete;
+    AsyncQueue& operator=(const AsyncQueue&)=delete;
+
+    // co_await pop() gives std::optional<T>, empty once closed and drained.
+    auto pop(){
+        struct Awaiter{
+            AsyncQueue& q;
+            PopWaiter w;
+            bool await_ready() const noexcept{ return false; }
+            bool await_suspend(const std::coroutine_handle<> h){
+                std::coroutine_handle<> wake;
+                {
+                    std::lock_guard<std::mutex> lock{q.mtx};
+                    if(!q.takeLocked(w.value, wake) && !q.closed){
+                        w.h=h;
+                        q.poppers.push_back(&w);
+                        return true;
+                    }
+                }
+                q.wakeUp(wake);
+                return false;
+            }
+            std::optional<T> await_resume(){ return std::move(w.value); }
+        };
+        return Awaiter{*this, PopWaiter{}};
+    }
+
+    // co_await push(v) gives false if the queue was closed first.
+    auto push(T v){
+        struct Awaiter{
+            AsyncQueue& q;
+            PushWaiter w;
+            bool await_ready() const noexcept{ return false; }
+            bool await_suspend(const std::coroutine_handle<> h){
+                std::coroutine_handle<> wake;
+                {
+                    std::lock_guard<std::mutex> lock{q.mtx};
+                    if(q.closed) return false;
+                    if(!q.putLocked(w.value, wake)){
+                        w.h=h;
+                        q.pushers.push_back(&w);
+                        return true;
+                    }
+                }
+                w.ok=true;
+                q.wakeUp(wake);
+                return false;
+            }
+            bool await_resume() const noexcept{ return w.ok; }
+        };
+        return Awaiter{*this, PushWaiter{{}, std::move(v), false}};
+    }
+
+    // For threads: false when full or closed, and v is left as it was.
+    bool tryPush(T& v){
+        std::coroutine_handle<> wake;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            if(!putLocked(v, wake)) return false;
+        }
+        wakeUp(wake);
+        return true;
+    }
+
+    bool tryPop(T& v){
+        std::coroutine_handle<> wake;
+        std::optional<T> out;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            if(!takeLocked(out, wake)) return false;
+        }
+        v=std::move(*out);
+        wakeUp(wake);
+        return true;
+    }
+
+    void close(){
+        std::vector<std::coroutine_handle<>> wake;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            closed=true;
+            for(PopWaiter* w : poppers) wake.push_back(w->h);
+            for(PushWaiter* w : pushers) wake.push_back(w->h);
+            poppers.clear();
+            pushers.clear();
+        }
+        for(auto h : wake) ex.post(h);
+    }
+
+    std::size_t size(){
+        std::lock_guard<std::mutex> lock{mtx};
+        return items.size();
+    }
+};
+
+#endif
+
+#endif
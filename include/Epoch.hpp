@@ -0,0 +1,110 @@
+#ifndef _EPOCH_H_
+#define _EPOCH_H_
+
+#include <atomic>
+#include <cstdint>
+
+// Epoch-based reclamation for structures read without locks. A reader pins the
+// current epoch in a slot of its own for the length of an EpochGuard, so the
+// read path writes only its own cache line. Writers stamp what they unlink with
+// the epoch at the time and free it once the global epoch is two past the
+// stamp: the epoch only moves when every pinned reader has seen the current
+// one, so by then no reader can still hold the pointer.
+class EpochDomain{
+    struct alignas(64) Slot{
+        std::atomic<std::uint64_t> epoch;
+        std::atomic<bool> owned;
+        Slot* next;
+
+        Slot(): epoch{0}, owned{true}, next{nullptr} {}
+    };
+
+    struct Local{
+        Slot* slot;
+        unsigned int depth;
+
+        explicit Local(Slot* s): slot{s}, depth{0} {}
+        ~Local(){
+            slot->epoch.store(0, std::memory_order_release);
+            slot->owned.store(false, std::memory_order_release);
+        }
+    };
+
+    std::atomic<std::uint64_t> global;
+    std::atomic<Slot*> slots;
+
+    EpochDomain(): global{1}, slots{nullptr} {}
+
+    // Slots are reused after their thread exits and never freed.
+    Slot* acquire(){
+        for(Slot* s=slots.load(std::memory_order_acquire); s; s=s->next){
+            bool free=false;
+            if(!s->owned.load(std::memory_order_relaxed) && s->owned.compare_exchange_strong(free, true)) return s;
+        }
+        Slot* s=new Slot;
+        s->next=slots.load(std::memory_order_relaxed);
+        while(!slots.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed));
+        return s;
+    }
+
+    Local& local(){
+        static thread_local Local l(acquire());
+        return l;
+    }
+
+public:
+    EpochDomain(const EpochDomain&)=delete;
+    EpochDomain& operator=(const EpochDomain&)=delete;
+
+    // One domain for the process, never destroyed, so threads that outlive
+    // static destruction can still leave it.
+    static EpochDomain& instance(){
+        static EpochDomain* domain=new EpochDomain;
+        return *domain;
+    }
+
+    void enter(){
+        Local& l=local();
+        if(l.depth++) return;
+        l.slot->epoch.store(global.load(std::memory_order_relaxed), std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void exit(){
+        Local& l=local();
+        if(--l.depth) return;
+        l.slot->epoch.store(0, std::memory_order_release);
+    }
+
+    std::uint64_t now() const{
+        return global.load(std::memory_order_acquire);
+    }
+
+    // Moves the epoch on by one if every pinned reader is in the current one,
+    // and returns the epoch as it now stands.
+    std::uint64_t tryAdvance(){
+        std::uint64_t e=global.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for(Slot* s=slots.load(std::memory_order_acquire); s; s=s->next){
+            const std::uint64_t pinned=s->epoch.load(std::memory_order_acquire);
+            if(pinned && pinned!=e) return e;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return global.compare_exchange_strong(e, e+1, std::memory_order_acq_rel)? e+1 : e;
+    }
+
+    static bool reclaimable(const std::uint64_t retired, const std::uint64_t current){
+        return retired+2<=current;
+    }
+};
+
+class EpochGuard{
+public:
+    EpochGuard(){ EpochDomain::instance().enter(); }
+    ~EpochGuard(){ EpochDomain::instance().exit(); }
+
+    EpochGuard(const EpochGuard&)=delete;
+    EpochGuard& operator=(const EpochGuard&)=delete;
+};
+
+#endif
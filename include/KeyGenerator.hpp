@@ -0,0 +1,94 @@
+#ifndef _KEYGENERATOR_H_
+#define _KEYGENERATOR_H_
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+
+enum class KeyDistribution{ Uniform, Zipfian };
+
+inline const char* distributionName(const KeyDistribution d){
+    return d==KeyDistribution::Zipfian? "zipf" : "uniform";
+}
+
+// Zipfian ranks in [0, n) after Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases", the same generator YCSB uses.
+class ZipfianGenerator{
+    std::uint64_t items;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+
+    static double zeta(const std::uint64_t n, const double theta){
+        double sum=0;
+        for(std::uint64_t i=1; i<=n; ++i) sum+=1.0/std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+public:
+    explicit ZipfianGenerator(const std::uint64_t n, const double th=0.99): items{n ? n : 1}, theta{th} {
+        zetan=zeta(items, theta);
+        const double zeta2=zeta(2, theta);
+        alpha=1.0/(1.0-theta);
+        eta=(1.0-std::pow(2.0/items, 1.0-theta))/(1.0-zeta2/zetan);
+    }
+
+    template<typename R>
+    std::uint64_t operator()(R& rng) const{
+        const double u=std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        const double uz=u*zetan;
+        if(uz<1.0) return 0;
+        if(uz<1.0+std::pow(0.5, theta)) return items>1? 1 : 0;
+        const std::uint64_t r=static_cast<std::uint64_t>(items*std::pow(eta*u-eta+1.0, alpha));
+        return r<items? r : items-1;
+    }
+
+    std::uint64_t size() const{ return items; }
+};
+
+// Keys in [0, n). Zipfian ranks are scrambled so the hot keys are spread over
+// the key space instead of clustering at the front of ordered containers.
+class KeyGenerator{
+    KeyDistribution dist;
+    std::uint64_t n;
+    ZipfianGenerator zipf;
+
+    static std::uint64_t fnv64(std::uint64_t v){
+        std::uint64_t h=14695981039346656037ULL;
+        for(int i=0; i<8; ++i){
+            h^=v & 0xff;
+            h*=1099511628211ULL;
+            v>>=8;
+        }
+        return h;
+    }
+
+public:
+    KeyGenerator(const KeyDistribution d, const std::uint64_t keys):
+        dist{d}, n{keys ? keys : 1}, zipf{d==KeyDistribution::Zipfian? n : 1} {}
+
+    template<typename R>
+    std::uint64_t operator()(R& rng) const{
+        if(dist==KeyDistribution::Zipfian) return fnv64(zipf(rng))%n;
+        return std::uniform_int_distribution<std::uint64_t>(0, n-1)(rng);
+    }
+
+    std::uint64_t size() const{ return n; }
+    KeyDistribution distribution() const{ return dist; }
+};
+
+inline bool parseDistribution(const std::string& s, KeyDistribution& d){
+    if(s=="uniform"){
+        d=KeyDistribution::Uniform;
+        return true;
+    }
+    if(s=="zipf" || s=="zipfian"){
+        d=KeyDistribution::Zipfian;
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef _LATENCYRECORDER_H_
+#define _LATENCYRECORDER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Log-linear latency histogram: exact below 64ns, then 32 sub-buckets per power
+// of two (about 3% relative error). One recorder per thread, merged afterwards.
+class LatencyRecorder{
+    static constexpr int linear=64;
+    static constexpr int subBits=5;
+    static constexpr int maxBits=44;
+
+    std::vector<std::uint64_t> buckets;
+    std::uint64_t total;
+    std::uint64_t maxNs;
+
+    static int msb(std::uint64_t v){
+        int m=0;
+        while(v>>=1) ++m;
+        return m;
+    }
+
+    static std::size_t indexOf(const std::uint64_t ns){
+        if(ns<linear) return static_cast<std::size_t>(ns);
+        int m=msb(ns);
+        if(m>=maxBits) return linear+(maxBits-subBits-1)*(1<<subBits)+((1<<subBits)-1);
+        const std::uint64_t sub=(ns>>(m-subBits)) & ((1<<subBits)-1);
+        return linear+(m-subBits-1)*(1<<subBits)+sub;
+    }
+
+    static std::uint64_t valueOf(const std::size_t idx){
+        if(idx<linear) return idx;
+        const std::size_t k=idx-linear;
+        const int m=static_cast<int>(k>>subBits)+subBits+1;
+        const std::uint64_t sub=k & ((1<<subBits)-1);
+        const std::uint64_t lo=(std::uint64_t(1)<<m) | (sub<<(m-subBits));
+        return lo+(std::uint64_t(1)<<(m-subBits))/2;
+    }
+
+public:
+    LatencyRecorder(): buckets(linear+(maxBits-subBits)*(1<<subBits), 0), total{0}, maxNs{0} {}
+
+    void record(const std::uint64_t ns){
+        ++buckets[indexOf(ns)];
+        ++total;
+        if(ns>maxNs) maxNs=ns;
+    }
+
+    void merge(const LatencyRecorder& o){
+        for(std::size_t i=0; i<buckets.size(); buckets[i]+=o.buckets[i], ++i);
+        total+=o.total;
+        if(o.maxNs>maxNs) maxNs=o.maxNs;
+    }
+
+    std::uint64_t percentile(const double p) const{
+        if(!total) return 0;
+        const std::uint64_t rank=static_cast<std::uint64_t>(p*(total-1));
+        std::uint64_t seen=0;
+        for(std::size_t i=0; i<buckets.size(); ++i){
+            seen+=buckets[i];
+            if(seen>rank){
+                const std::uint64_t v=valueOf(i);
+                return v<maxNs? v : maxNs;
+            }
+        }
+        return maxNs;
+    }
+
+    std::uint64_t count() const{ return total; }
+    std::uint64_t max() const{ return maxNs; }
+};
+
+inline std::uint64_t nowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,350 @@
+#ifndef _LOCKSTATS_H_
+#define _LOCKSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+
+// Build with -DTHREADSAFE_STATS to make the containers count lock and operation
+// activity. Without it the aliases below are the plain std types and every
+// counting call is an empty inline function.
+
+struct HistogramSnapshot{
+    static constexpr int numBuckets=40;
+    std::uint64_t buckets[numBuckets]={};
+    std::uint64_t count=0;
+    std::uint64_t totalNs=0;
+
+    void merge(const HistogramSnapshot& o){
+        for(int i=0; i<numBuckets; buckets[i]+=o.buckets[i], ++i);
+        count+=o.count;
+        totalNs+=o.totalNs;
+    }
+
+    std::uint64_t percentile(const double p) const{
+        if(!count) return 0;
+        const std::uint64_t rank=static_cast<std::uint64_t>(p*(count-1));
+        std::uint64_t seen=0;
+        for(int i=0; i<numBuckets; ++i){
+            seen+=buckets[i];
+            if(seen>rank) return std::uint64_t(1)<<i;
+        }
+        return std::uint64_t(1)<<(numBuckets-1);
+    }
+
+    std::string toJson() const{
+        std::ostringstream out;
+        out << "{\"count\": " << count << ", \"total_ns\": " << totalNs
+            << ", \"p50_ns\": " << percentile(0.5) << ", \"p99_ns\": " << percentile(0.99)
+            << ", \"p999_ns\": " << percentile(0.999) << ", \"log2_buckets\": [";
+        for(int i=0; i<numBuckets; ++i) out << (i? ", " : "") << buckets[i];
+        out << "]}";
+        return out.str();
+    }
+};
+
+class Histogram{
+    std::atomic<std::uint64_t> buckets[HistogramSnapshot::numBuckets];
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> totalNs;
+
+public:
+    Histogram(): count{0}, totalNs{0} {
+        for(auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+
+    void record(const std::uint64_t ns){
+        int b=0;
+        for(std::uint64_t v=ns; v>1 && b<HistogramSnapshot::numBuckets-1; v>>=1, ++b);
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const{
+        HistogramSnapshot s;
+        for(int i=0; i<HistogramSnapshot::numBuckets; ++i) s.buckets[i]=buckets[i].load(std::memory_order_relaxed);
+        s.count=count.load(std::memory_order_relaxed);
+        s.totalNs=totalNs.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+struct LockStatsSnapshot{
+    std::uint64_t acquisitions=0;
+    std::uint64_t contended=0;
+    std::uint64_t sharedAcquisitions=0;
+    HistogramSnapshot waitNs;
+    HistogramSnapshot holdNs;
+    HistogramSnapshot sharedHoldNs;
+
+    void merge(const LockStatsSnapshot& o){
+        acquisitions+=o.acquisitions;
+        contended+=o.contended;
+        sharedAcquisitions+=o.sharedAcquisitions;
+        waitNs.merge(o.waitNs);
+        holdNs.merge(o.holdNs);
+        sharedHoldNs.merge(o.sharedHoldNs);
+    }
+
+    std::string toJson() const{
+        std::ostringstream out;
+        out << "{\"acquisitions\": " << acquisitions << ", \"contended\": " << contended
+            << ", \"shared_acquisitions\": " << sharedAcquisitions
+            << ", \"wait\": " << waitNs.toJson() << ", \"hold\": " << holdNs.toJson()
+            << ", \"shared_hold\": " << sharedHoldNs.toJson() << "}";
+        return out.str();
+    }
+};
+
+class LockStats{
+    std::atomic<std::uint64_t> acquisitions;
+    std::atomic<std::uint64_t> contended;
+    std::atomic<std::uint64_t> sharedAcquisitions;
+    Histogram waitNs;
+    Histogram holdNs;
+    Histogram sharedHoldNs;
+
+public:
+    LockStats(): acquisitions{0}, contended{0}, sharedAcquisitions{0} {}
+
+    void acquired(const bool wasContended, const std::uint64_t waited, const bool shared=false){
+        (shared? sharedAcquisitions : acquisitions).fetch_add(1, std::memory_order_relaxed);
+        if(wasContended){
+            contended.fetch_add(1, std::memory_order_relaxed);
+            waitNs.record(waited);
+        }
+    }
+
+    void released(const std::uint64_t held, const bool shared=false){
+        (shared? sharedHoldNs : holdNs).record(held);
+    }
+
+    LockStatsSnapshot snapshot() const{
+        LockStatsSnapshot s;
+        s.acquisitions=acquisitions.load(std::memory_order_relaxed);
+        s.contended=contended.load(std::memory_order_relaxed);
+        s.sharedAcquisitions=sharedAcquisitions.load(std::memory_order_relaxed);
+        s.waitNs=waitNs.snapshot();
+        s.holdNs=holdNs.snapshot();
+        s.sharedHoldNs=sharedHoldNs.snapshot();
+        return s;
+    }
+};
+
+inline std::uint64_t statClockNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename M>
+class InstrumentedMutex{
+    M mtx;
+    LockStats* stats;
+    std::uint64_t acquiredAt;
+
+    // Many threads can share the lock at once, so each keeps its own acquire
+    // times, keyed by mutex since a thread may hold several shared locks.
+    static std::vector<std::pair<const InstrumentedMutex*, std::uint64_t>>& sharedSince(){
+        thread_local std::vector<std::pair<const InstrumentedMutex*, std::uint64_t>> since;
+        return since;
+    }
+
+public:
+    InstrumentedMutex(): stats{nullptr}, acquiredAt{0} {}
+    InstrumentedMutex(const InstrumentedMutex&)=delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&)=delete;
+
+    void bind(LockStats* s){ stats=s; }
+
+    void lock(){
+        if(!stats){
+            mtx.lock();
+            return;
+        }
+        bool wasContended=false;
+        std::uint64_t waited=0;
+        if(!mtx.try_lock()){
+            const std::uint64_t start=statClockNs();
+            mtx.lock();
+            waited=statClockNs()-start;
+            wasContended=true;
+        }
+        acquiredAt=statClockNs();
+        stats->acquired(wasContended, waited);
+    }
+
+    bool try_lock(){
+        if(!mtx.try_lock()) return false;
+        if(stats){
+            acquiredAt=statClockNs();
+            stats->acquired(false, 0);
+        }
+        return true;
+    }
+
+    void unlock(){
+        if(stats) stats->released(statClockNs()-acquiredAt);
+        mtx.unlock();
+    }
+
+    void lock_shared(){
+        if(!stats){
+            mtx.lock_shared();
+            return;
+        }
+        bool wasContended=false;
+        std::uint64_t waited=0;
+        if(!mtx.try_lock_shared()){
+            const std::uint64_t start=statClockNs();
+            mtx.lock_shared();
+            waited=statClockNs()-start;
+            wasContended=true;
+        }
+        sharedSince().emplace_back(this, statClockNs());
+        stats->acquired(wasContended, waited, true);
+    }
+
+    bool try_lock_shared(){
+        if(!mtx.try_lock_shared()) return false;
+        if(stats){
+            sharedSince().emplace_back(this, statClockNs());
+            stats->acquired(false, 0, true);
+        }
+        return true;
+    }
+
+    void unlock_shared(){
+        auto& since=sharedSince();
+        for(auto it=since.rbegin(); it!=since.rend(); ++it){
+            if(it->first!=this) continue;
+            if(stats) stats->released(statClockNs()-it->second, true);
+            since.erase(std::next(it).base());
+            break;
+        }
+        mtx.unlock_shared();
+    }
+};
+
+struct OpStatsSnapshot{
+    std::uint64_t pushes=0;
+    std::uint64_t pops=0;
+    std::uint64_t traversals=0;
+    std::uint64_t traversalSteps=0;
+    std::uint64_t retries=0;
+
+    void merge(const OpStatsSnapshot& o){
+        pushes+=o.pushes;
+        pops+=o.pops;
+        traversals+=o.traversals;
+        traversalSteps+=o.traversalSteps;
+        retries+=o.retries;
+    }
+
+    std::string toJson() const{
+        std::ostringstream out;
+        out << "{\"pushes\": " << pushes << ", \"pops\": " << pops << ", \"traversals\": " << traversals
+            << ", \"traversal_steps\": " << traversalSteps << ", \"retries\": " << retries << "}";
+        return out.str();
+    }
+};
+
+struct ContainerStats{
+    LockStatsSnapshot locks;
+    OpStatsSnapshot ops;
+
+    void merge(const ContainerStats& o){
+        locks.merge(o.locks);
+        ops.merge(o.ops);
+    }
+
+    std::string toJson() const{
+        return "{\"locks\": " + locks.toJson() + ", \"ops\": " + ops.toJson() + "}";
+    }
+};
+
+#ifdef THREADSAFE_STATS
+
+typedef InstrumentedMutex<std::mutex> StatMutex;
+typedef InstrumentedMutex<std::shared_mutex> StatSharedMutex;
+typedef std::condition_variable_any StatCondVar;
+
+class OpStats{
+    std::atomic<std::uint64_t> pushes;
+    std::atomic<std::uint64_t> pops;
+    std::atomic<std::uint64_t> traversals;
+    std::atomic<std::uint64_t> traversalSteps;
+    std::atomic<std::uint64_t> retries;
+
+public:
+    OpStats(): pushes{0}, pops{0}, traversals{0}, traversalSteps{0}, retries{0} {}
+
+    void push(){ pushes.fetch_add(1, std::memory_order_relaxed); }
+    void pop(){ pops.fetch_add(1, std::memory_order_relaxed); }
+    void traversal(const std::uint64_t steps){
+        traversals.fetch_add(1, std::memory_order_relaxed);
+        traversalSteps.fetch_add(steps, std::memory_order_relaxed);
+    }
+    void retry(){ retries.fetch_add(1, std::memory_order_relaxed); }
+
+    OpStatsSnapshot snapshot() const{
+        OpStatsSnapshot s;
+        s.pushes=pushes.load(std::memory_order_relaxed);
+        s.pops=pops.load(std::memory_order_relaxed);
+        s.traversals=traversals.load(std::memory_order_relaxed);
+        s.traversalSteps=traversalSteps.load(std::memory_order_relaxed);
+        s.retries=retries.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+class ContainerStatsSink{
+    mutable LockStats lockStats;
+    mutable OpStats opStats;
+
+public:
+    template<typename M>
+    void bind(InstrumentedMutex<M>& m) const{ m.bind(&lockStats); }
+
+    OpStats& ops() const{ return opStats; }
+
+    ContainerStats snapshot() const{
+        return ContainerStats{lockStats.snapshot(), opStats.snapshot()};
+    }
+};
+
+#else
+
+typedef std::mutex StatMutex;
+typedef std::shared_mutex StatSharedMutex;
+typedef std::condition_variable StatCondVar;
+
+struct OpStats{
+    void push() const {}
+    void pop() const {}
+    void traversal(std::uint64_t) const {}
+    void retry() const {}
+};
+
+struct ContainerStatsSink{
+    template<typename M>
+    void bind(M&) const {}
+
+    OpStats ops() const{ return OpStats(); }
+
+    ContainerStats snapshot() const{
+        return ContainerStats();
+    }
+};
+
+#endif
+
+#endif
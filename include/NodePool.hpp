@@ -0,0 +1,208 @@
+#ifndef _NODEPOOL_H_
+#define _NODEPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Size-classed pool of fixed-size blocks. Every thread keeps a private cache per
+// size class; blocks move between threads in whole batches through a lock-free
+// depot, so the allocator is only hit when the pool grows.
+class NodePool{
+    struct Block{
+        Block* next;
+        Block* nextBatch;
+    };
+
+    static constexpr std::size_t granularity=16;
+    static constexpr std::size_t numClasses=32;
+    static constexpr std::uintptr_t ptrMask=(std::uintptr_t(1)<<48)-1;
+
+    static_assert(sizeof(void*)==8, "NodePool tags the upper 16 bits of depot pointers");
+
+    struct SizeClass{
+        std::size_t blockSize;
+        std::size_t batchSize;
+        std::atomic<std::uintptr_t> depot;
+        std::atomic<std::size_t> slabs;
+
+        SizeClass(): blockSize{0}, batchSize{0}, depot{0}, slabs{0} {}
+
+        void pushBatch(Block* batch){
+            std::uintptr_t old=depot.load(std::memory_order_relaxed);
+            std::uintptr_t tagged;
+            do{
+                batch->nextBatch=reinterpret_cast<Block*>(old & ptrMask);
+                tagged=reinterpret_cast<std::uintptr_t>(batch) | ((old & ~ptrMask) + (ptrMask+1));
+            }while(!depot.compare_exchange_weak(old, tagged, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        Block* popBatch(){
+            std::uintptr_t old=depot.load(std::memory_order_acquire);
+            while(Block* top=reinterpret_cast<Block*>(old & ptrMask)){
+                std::uintptr_t tagged=reinterpret_cast<std::uintptr_t>(top->nextBatch) | ((old & ~ptrMask) + (ptrMask+1));
+                if(depot.compare_exchange_weak(old, tagged, std::memory_order_acquire, std::memory_order_acquire)) return top;
+            }
+            return nullptr;
+        }
+
+        Block* carveBatch(){
+            char* slab=static_cast<char*>(::operator new(blockSize*batchSize));
+            slabs.fetch_add(1, std::memory_order_relaxed);
+            for(std::size_t i=0; i<batchSize; ++i){
+                Block* b=reinterpret_cast<Block*>(slab+i*blockSize);
+                b->next= i+1<batchSize? reinterpret_cast<Block*>(slab+(i+1)*blockSize) : nullptr;
+            }
+            return reinterpret_cast<Block*>(slab);
+        }
+    };
+
+    struct ThreadCache{
+        Block* head[numClasses];
+        std::size_t count[numClasses];
+
+        ThreadCache(){
+            for(std::size_t i=0; i<numClasses; head[i]=nullptr, count[i]=0, ++i);
+        }
+
+        ~ThreadCache(){
+            for(std::size_t i=0; i<numClasses; ++i){
+                while(head[i]) release(i);
+            }
+        }
+
+        void release(const std::size_t cls){
+            SizeClass& sc=classes()[cls];
+            Block* batch=head[cls];
+            Block* last=batch;
+            std::size_t k=1;
+            for(; k<sc.batchSize && last->next; ++k) last=last->next;
+            head[cls]=last->next;
+            last->next=nullptr;
+            count[cls]-=k;
+            sc.pushBatch(batch);
+        }
+    };
+
+    static SizeClass* classes(){
+        static SizeClass* table=[]{
+            SizeClass* t=new SizeClass[numClasses];
+            for(std::size_t i=0; i<numClasses; ++i){
+                t[i].blockSize=(i+1)*granularity;
+                const std::size_t perBatch=16384/t[i].blockSize;
+                t[i].batchSize= perBatch<32? 32 : perBatch;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    static ThreadCache& cache(){
+        static thread_local ThreadCache tc;
+        return tc;
+    }
+
+    static bool pooled(const std::size_t bytes, const std::size_t align){
+        return bytes && bytes<=granularity*numClasses && align<=granularity;
+    }
+
+    static std::size_t classOf(const std::size_t bytes){
+        return (bytes-1)/granularity;
+    }
+
+public:
+    static void* allocate(const std::size_t bytes, const std::size_t align=alignof(std::max_align_t)){
+        if(!pooled(bytes, align)) return ::operator new(bytes, std::align_val_t(align));
+
+        const std::size_t cls=classOf(bytes);
+        ThreadCache& tc=cache();
+        if(!tc.head[cls]){
+            SizeClass& sc=classes()[cls];
+            Block* batch=sc.popBatch();
+            tc.head[cls]= batch? batch : sc.carveBatch();
+            tc.count[cls]=sc.batchSize;
+        }
+        Block* b=tc.head[cls];
+        tc.head[cls]=b->next;
+        --tc.count[cls];
+        return b;
+    }
+
+    static void deallocate(void* p, const std::size_t bytes, const std::size_t align=alignof(std::max_align_t)) noexcept{
+        if(!p) return;
+        if(!pooled(bytes, align)){
+            ::operator delete(p, std::align_val_t(align));
+            return;
+        }
+
+        const std::size_t cls=classOf(bytes);
+        ThreadCache& tc=cache();
+        Block* b=static_cast<Block*>(p);
+        b->next=tc.head[cls];
+        tc.head[cls]=b;
+        if(++tc.count[cls] >= 2*classes()[cls].batchSize) tc.release(cls);
+    }
+
+    static std::size_t slabCount(const std::size_t bytes){
+        return pooled(bytes, 1)? classes()[classOf(bytes)].slabs.load(std::memory_order_relaxed) : 0;
+    }
+};
+
+template<typename T>
+class PoolAllocator{
+public:
+    typedef T value_type;
+
+    PoolAllocator() noexcept {}
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(const std::size_t n){
+        return static_cast<T*>(NodePool::allocate(n*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, const std::size_t n) noexcept{
+        NodePool::deallocate(p, n*sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+template<typename Alloc, typename U>
+using RebindAlloc=typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+template<typename Alloc, typename... Args>
+typename std::allocator_traits<Alloc>::value_type* newNode(Alloc alloc, Args&&... args){
+    typedef std::allocator_traits<Alloc> Traits;
+    auto p=Traits::allocate(alloc, 1);
+    try{
+        Traits::construct(alloc, p, std::forward<Args>(args)...);
+    }catch(...){
+        Traits::deallocate(alloc, p, 1);
+        throw;
+    }
+    return p;
+}
+
+template<typename Alloc>
+void deleteNode(Alloc alloc, typename std::allocator_traits<Alloc>::value_type* p){
+    typedef std::allocator_traits<Alloc> Traits;
+    if(!p) return;
+    Traits::destroy(alloc, p);
+    Traits::deallocate(alloc, p, 1);
+}
+
+template<typename Alloc>
+struct NodeDeleter{
+    void operator()(typename std::allocator_traits<Alloc>::value_type* p) const{
+        deleteNode(Alloc(), p);
+    }
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef _QUEUESELECTOR_H_
+#define _QUEUESELECTOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "QueueWait.hpp"
+#include "ThreadSafeQueue.hpp"
+#include "ThreadSafeQueue1.hpp"
+
+enum class SelectPolicy{
+    RoundRobin, // one item from each ready queue in turn
+    Weighted    // up to weight items from a queue before moving on
+};
+
+// Waits on several queues at once from one thread. Every added queue notifies
+// the selector's QueueNotifier on push and close, so select() polls briefly
+// and then sleeps until one of them has something, rather than spinning over
+// tryDequeue. The queues must outlive the selector, and one selector serves
+// one consumer thread at a time.
+template<typename T>
+class QueueSelector{
+    struct Source{
+        std::function<bool(T&)> tryPop;
+        std::function<bool()> closed;
+        std::function<bool()> hinted;
+        std::function<void()> detach;
+        unsigned int weight;
+    };
+
+    QueueNotifier notifier;
+    std::vector<Source> sources;
+    SelectPolicy policy;
+    SpinThenPark spinner;
+    std::size_t cursor{0};
+    unsigned int served{0};
+
+    // One pass over the sources, starting where the policy left off.
+    bool scan(T& val, std::size_t& from){
+        const std::size_t n=sources.size();
+        for(std::size_t k=0; k<n; ++k){
+            const std::size_t i=(cursor+k)%n;
+            if(i!=cursor) served=0;
+            if(!sources[i].tryPop(val)) continue;
+            from=i;
+            const unsigned int quota= policy==SelectPolicy::Weighted? sources[i].weight : 1;
+            if(++served>=quota){
+                cursor=(i+1)%n;
+                served=0;
+            }else{
+                cursor=i;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool allClosed() const{
+        for(const auto& s : sources){
+            if(!s.closed()) return false;
+        }
+        return true;
+    }
+
+    // park(seen) sleeps while the notifier is still at seen and says whether
+    // to keep waiting.
+    template<typename Park>
+    bool selectWith(T& val, std::size_t& from, Park park){
+        if(sources.empty()) return false;
+        spinner.spin([this]{
+            for(const auto& s : sources){
+                if(s.hinted()) return true;
+            }
+            return false;
+        });
+        while(true){
+            const std::uint64_t seen=notifier.sequence();
+            const bool closed=allClosed();
+            if(scan(val, from)) return true;
+            if(closed || !park(seen)) return false;
+        }
+    }
+
+public:
+    explicit QueueSelector(const SelectPolicy p=SelectPolicy::RoundRobin): policy{p} {}
+
+    ~QueueSelector(){
+        for(auto& s : sources) s.detach();
+    }
+
+    QueueSelector(const QueueSelector&)=delete;
+    QueueSelector& operator=(const QueueSelector&)=delete;
+
+    // Returns the index select() reports for items from q.
+    template<typename Alloc>
+    std::size_t add(ThreadSafeQueue<T, Alloc>& q, const unsigned int weight=1){
+        q.attach(&notifier);
+        sources.push_back(Source{
+            [&q](T& v){ return q.tryDequeue(v); },
+            [&q]{ return q.isClosed(); },
+            [&q]{ return q.approxSize()>0; },
+            [&q, this]{ q.detach(&notifier); },
+            weight? weight : 1});
+        return sources.size()-1;
+    }
+
+    std::size_t add(ThreadSafeQueue1<T>& q, const unsigned int weight=1){
+        q.attach(&notifier);
+        sources.push_back(Source{
+            [&q](T& v){ return q.tryPop(v); },
+            [&q]{ return q.isClosed(); },
+            [&q]{ return q.approxSize()>0; },
+            [&q, this]{ q.detach(&notifier); },
+            weight? weight : 1});
+        return sources.size()-1;
+    }
+
+    // Takes the next item by the policy into val, and its queue's index into
+    // from. false once every queue is closed and drained.
+    bool select(T& val, std::size_t& from){
+        return selectWith(val, from, [this](const std::uint64_t seen){
+            notifier.wait(seen);
+            return true;
+        });
+    }
+
+    // Also false on timeout.
+    template<typename Rep, typename Period>
+    bool selectFor(T& val, std::size_t& from, const std::chrono::duration<Rep, Period>& timeout){
+        return selectUntil(val, from, std::chrono::steady_clock::now()+timeout);
+    }
+
+    template<typename Clock, typename Duration>
+    bool selectUntil(T& val, std::size_t& from, const std::chrono::time_point<Clock, Duration>& deadline){
+        return selectWith(val, from, [this, &deadline](const std::uint64_t seen){
+            return notifier.waitUntil(seen, deadline);
+        });
+    }
+
+    std::size_t size() const{
+        return sources.size();
+    }
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef _QUEUEWAIT_H_
+#define _QUEUEWAIT_H_
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<stop_token>)
+#include <stop_token>
+#endif
+
+#if defined(__cpp_lib_jthread)
+#define QUEUE_STOP_TOKEN 1
+#endif
+
+class QueueClosedException: public std::exception{
+    std::string msg;
+public:
+    QueueClosedException(std::string message="Queue is closed"): msg{std::move(message)} {}
+    virtual const char* what() const noexcept override{
+        return msg.c_str();
+    }
+};
+
+inline void cpuRelax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// How long a blocking pop polls before it parks on the condition variable.
+// The budget doubles whenever polling found work and halves whenever it had
+// to park, so a queue that is fed steadily hands items over in well under a
+// microsecond, and an idle one quickly goes back to sleeping for free.
+class SpinThenPark{
+    static constexpr int minSpins=8;
+    static constexpr int maxSpins=2048;
+
+    std::atomic<int> budget{64};
+
+public:
+    // Polls ready() for up to the current budget; true once it held.
+    template<typename Ready>
+    bool spin(Ready ready){
+        const int n=budget.load(std::memory_order_relaxed);
+        for(int i=0; i<n; ++i){
+            if(ready()){
+                if(n<maxSpins) budget.store(std::min(maxSpins, n*2), std::memory_order_relaxed);
+                return true;
+            }
+            cpuRelax();
+        }
+        budget.store(std::max(minSpins, n/2), std::memory_order_relaxed);
+        return false;
+    }
+};
+
+// Wakeup shared by everything a QueueSelector watches: each push or close on
+// a watched queue bumps the sequence number. A waiter reads it before looking
+// at the queues and sleeps only while it is unchanged, so a push that lands
+// after the look still wakes it.
+class QueueNotifier{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::uint64_t seq{0};
+
+public:
+    void notify(){
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            ++seq;
+        }
+        cv.notify_all();
+    }
+
+    std::uint64_t sequence(){
+        std::lock_guard<std::mutex> lock{mtx};
+        return seq;
+    }
+
+    // false if the deadline passed with the sequence still at seen.
+    template<typename Clock, typename Duration>
+    bool waitUntil(const std::uint64_t seen, const std::chrono::time_point<Clock, Duration>& deadline){
+        std::unique_lock<std::mutex> lock{mtx};
+        return cv.wait_until(lock, deadline, [&]{ return seq!=seen; });
+    }
+
+    void wait(const std::uint64_t seen){
+        std::unique_lock<std::mutex> lock{mtx};
+        cv.wait(lock, [&]{ return seq!=seen; });
+    }
+};
+
+// The notifiers watching one queue. Unwatched queues pay one load per push.
+class QueueWatchers{
+    std::mutex mtx;
+    std::vector<QueueNotifier*> list;
+    std::atomic<int> n{0};
+
+public:
+    void attach(QueueNotifier* w){
+        std::lock_guard<std::mutex> lock{mtx};
+        list.push_back(w);
+        n.store(static_cast<int>(list.size()), std::memory_order_release);
+    }
+
+    void detach(QueueNotifier* w){
+        std::lock_guard<std::mutex> lock{mtx};
+        list.erase(std::remove(list.begin(), list.end(), w), list.end());
+        n.store(static_cast<int>(list.size()), std::memory_order_release);
+    }
+
+    void notify(){
+        if(n.load(std::memory_order_acquire)==0) return;
+        std::lock_guard<std::mutex> lock{mtx};
+        for(QueueNotifier* w : list) w->notify();
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _SHARDEDCOUNTER_H_
+#define _SHARDEDCOUNTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+// Counter split over cache-line-sized cells. Each thread always adds into the
+// same cell, so updaters on different cores rarely share a line, and a reader
+// sums the cells without taking anything. The sum is exact once the updates it
+// should see have happened before the read (say, under the lock that orders
+// them); while updates are in flight it can be briefly off, even negative.
+class ShardedCounter{
+    struct alignas(64) Cell{
+        std::atomic<std::int64_t> value{0};
+    };
+
+    std::unique_ptr<Cell[]> cells;
+
+    static std::size_t cellCount(){
+        static const std::size_t n=[]{
+            std::size_t c=1;
+            const std::size_t cores=std::max(1u, std::thread::hardware_concurrency());
+            while(c<cores && c<64) c<<=1;
+            return c;
+        }();
+        return n;
+    }
+
+    static std::size_t threadCell(){
+        static std::atomic<std::size_t> next{0};
+        static thread_local const std::size_t mine=next.fetch_add(1, std::memory_order_relaxed);
+        return mine & (cellCount()-1);
+    }
+
+public:
+    ShardedCounter(): cells{new Cell[cellCount()]} {}
+
+    ShardedCounter(const ShardedCounter&)=delete;
+    ShardedCounter& operator=(const ShardedCounter&)=delete;
+
+    void add(const std::int64_t d=1){
+        cells[threadCell()].value.fetch_add(d, std::memory_order_relaxed);
+    }
+
+    void sub(const std::int64_t d=1){
+        add(-d);
+    }
+
+    std::int64_t load() const{
+        std::int64_t sum=0;
+        for(std::size_t i=0; i<cellCount(); ++i) sum+=cells[i].value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    // load() clamped at zero, for element counts.
+    std::size_t size() const{
+        return static_cast<std::size_t>(std::max<std::int64_t>(0, load()));
+    }
+};
+
+#endif
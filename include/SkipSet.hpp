@@ -0,0 +1,812 @@
+#ifndef _SKIPSET_H_
+#define _SKIPSET_H_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <shared_mutex>
+#include <mutex>
+#include <memory>
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SKIPSET_AVX2 1
+#include <immintrin.h>
+#endif
+
+#include "NodePool.hpp"
+#include "LockStats.hpp"
+#include "Epoch.hpp"
+#include "ShardedCounter.hpp"
+
+// How SkipSet orders keys against a lookup key Q. A lookup builds one probe
+// from Q, so finding by something other than K (a string_view for a string
+// key, say) never builds a K, and every node derives from Cache.
+template<typename K, typename Enable=void>
+struct KeyOrder{
+    struct Cache{
+        explicit Cache(const K&) {}
+    };
+
+    template<typename Q>
+    struct Probe{
+        const Q& key;
+    };
+
+    template<typename Q, typename=void>
+    struct Accepts: std::false_type {};
+    template<typename Q>
+    struct Accepts<Q, std::void_t<decltype(std::declval<const K&>()<std::declval<const Q&>()),
+                                  decltype(std::declval<const Q&>()<std::declval<const K&>()),
+                                  decltype(std::declval<const K&>()==std::declval<const Q&>())>>: std::true_type {};
+
+    template<typename Q>
+    static Probe<Q> probe(const Q& k){
+        return Probe<Q>{k};
+    }
+
+    template<typename Q>
+    static bool less(const Cache&, const K& a, const Probe<Q>& p){
+        return a<p.key;
+    }
+
+    template<typename Q>
+    static bool equal(const Cache&, const K& a, const Probe<Q>& p){
+        return a==p.key;
+    }
+};
+
+// String keys are probed through a string_view, so const char* and string_view
+// lookups allocate nothing, and nodes keep the key's first eight bytes
+// big-endian: most steps are one integer compare, and the full compare only
+// runs when the prefixes tie. Short keys themselves already sit inline in the
+// node through the string's small-buffer storage.
+template<>
+struct KeyOrder<std::string>{
+    static std::uint64_t prefixOf(const std::string_view s){
+        std::uint64_t p=0;
+        const std::size_t n=std::min<std::size_t>(s.size(), 8);
+        for(std::size_t i=0; i<8; ++i) p=(p<<8) | (i<n? static_cast<unsigned char>(s[i]) : 0);
+        return p;
+    }
+
+    struct Cache{
+        std::uint64_t prefix;
+        explicit Cache(const std::string& k): prefix{prefixOf(k)} {}
+    };
+
+    struct Probe{
+        std::string_view key;
+        std::uint64_t prefix;
+    };
+
+    template<typename Q>
+    struct Accepts: std::is_convertible<const Q&, std::string_view> {};
+
+    template<typename Q>
+    static Probe probe(const Q& k){
+        const std::string_view s(k);
+        return Probe{s, prefixOf(s)};
+    }
+
+    static bool less(const Cache& c, const std::string& a, const Probe& p){
+        return c.prefix!=p.prefix? c.prefix<p.prefix : std::string_view(a)<p.key;
+    }
+
+    static bool equal(const Cache& c, const std::string& a, const Probe& p){
+        return c.prefix==p.prefix && std::string_view(a)==p.key;
+    }
+};
+
+template<typename K, typename Q>
+using IfLookupKey=std::enable_if_t<KeyOrder<K>::template Accepts<Q>::value>;
+
+// Writers serialize on mtx; find() takes no lock. Links are published with
+// release stores, bottom level first on insert and top level first on removal,
+// and unlinked nodes are freed only once the epoch shows no reader can still
+// be on them, so a lookup only ever writes its own epoch slot.
+
+template<typename K, typename V, typename Alloc=PoolAllocator<std::pair<K, V>>, typename Enable=void>
+class SkipSet{
+    typedef typename std::pair<K, V> T;
+    typedef KeyOrder<K> Order;
+
+    struct Node: Order::Cache{
+        T info;
+        std::vector<std::atomic<Node*>, RebindAlloc<Alloc, std::atomic<Node*>>> next;
+        int height;
+
+        Node(const T& t, const int hv): Order::Cache(t.first), info{t}, next(hv+1), height{hv} {
+            for(auto& p : next) p.store(nullptr, std::memory_order_relaxed);
+        }
+
+    };
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+
+    static constexpr std::size_t reclaimBatch=64;
+
+    Node *root;
+    int h;
+    ShardedCounter count;
+    mutable StatSharedMutex mtx;
+    ContainerStatsSink sink;
+    std::vector<std::pair<std::uint64_t, Node*>> limbo;
+
+    static Node* link(const Node* node, const int r){
+        return node->next[r].load(std::memory_order_acquire);
+    }
+
+    void retire(Node* node);
+    void reclaim();
+    void destroySet();
+
+    int setHeight() const{
+        const int z=std::rand();
+        int m=1;
+        int k=0;
+        while((m & z)){
+            k++;
+            m<<=1;
+        }
+        return k;
+    }
+
+    template<typename P>
+    static bool before(const Node* node, const P& p){
+        return Order::less(*node, node->info.first, p);
+    }
+
+    template<typename P>
+    static bool matches(const Node* node, const P& p){
+        return node && Order::equal(*node, node->info.first, p);
+    }
+
+    template<typename P>
+    int updateParams(Node* &curr, Node* &prev, const int r, const P& p) const;
+    template<typename P>
+    bool findEntry(const P& p, V& v) const;
+    template<typename P>
+    bool removeEntry(const P& p, V& v);
+
+    std::ostream& printSS(std::ostream& out) const;
+    friend std::ostream& operator<<(std::ostream& out, const SkipSet& ss){
+        return ss.printSS(out);
+    }
+
+
+public:
+    SkipSet(){
+        root=newNode(NodeAlloc(), T(K{}, V{}), sizeof(int)*8);
+        h=root->height;
+        sink.bind(mtx);
+    }
+
+    ~SkipSet(){
+        destroySet();
+    }
+
+    void add(const T& t);
+    bool update(const T& old, const T& t);
+
+    // Q is K or anything KeyOrder<K> accepts, e.g. string_view or const char*
+    // for string keys.
+    template<typename Q=K, typename=IfLookupKey<K, Q>>
+    std::shared_ptr<V> find(const Q& k) const{
+        V v;
+        return findEntry(Order::probe(k), v)? std::allocate_shared<V>(RebindAlloc<Alloc, V>(), std::move(v)) : std::make_shared<V>();
+    }
+
+    template<typename Q=K, typename=IfLookupKey<K, Q>>
+    bool find(const Q& k, V& v) const{
+        return findEntry(Order::probe(k), v);
+    }
+
+    template<typename Q=K, typename=IfLookupKey<K, Q>>
+    bool remove(const Q& k, V& v){
+        return removeEntry(Order::probe(k), v);
+    }
+
+    template<typename Q=K, typename=IfLookupKey<K, Q>>
+    std::shared_ptr<V> remove(const Q& k){
+        V v;
+        return removeEntry(Order::probe(k), v)? std::allocate_shared<V>(RebindAlloc<Alloc, V>(), std::move(v)) : std::make_shared<V>();
+    }
+
+    template<typename Func>
+    void forRange(const K& lo, const K& hi, Func fn) const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        Node* curr=root, *prev=nullptr;
+        const auto probe=Order::probe(lo);
+        for(int r=h; r>=0; --r) updateParams(curr, prev, r, probe);
+        for(Node* node=link(curr, 0); node && !(hi<node->info.first); node=link(node, 0)){
+            fn(node->info.first, node->info.second);
+        }
+    }
+
+    std::map<K, V> getMap() const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        std::map<K, V> res;
+        for(Node* node=link(root, 0); node; res.insert(node->info), node=link(node, 0));
+        return res;
+    }
+
+    int size() const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        return static_cast<int>(count.size());
+    }
+
+    // Lock-free; may lag writers still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+    
+};
+
+template<typename K, typename V, typename Alloc, typename Enable>
+bool SkipSet<K, V, Alloc, Enable>::update(const T& old, const T& t){
+
+    if(old.first != t.first) {
+        return false;
+    }else{
+        if(old.second == t.second) return false;
+    }
+
+    
+    Node* curr=root, *prev=nullptr;
+    const auto probe=Order::probe(old.first);
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    int r=h;
+    while(r>=0){
+        updateParams(curr, prev, r, probe);
+        if(matches(link(curr, r), probe)){
+            lock.unlock();
+            V v;
+            removeEntry(probe, v);
+            add(t);
+            return true;
+        }
+        r--;
+    }
+    return false;
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+template<typename P>
+bool SkipSet<K, V, Alloc, Enable>::removeEntry(const P& p, V& v){
+    Node* curr=root, *prev=nullptr, *del=nullptr;
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    int r=h;
+    while(r>=0){
+        updateParams(curr, prev, r, p);
+        Node* next=link(curr, r);
+        if(matches(next, p)){
+            del=next;
+            curr->next[r].store(link(del, r), std::memory_order_release);
+        }
+        r--;
+    }
+    // h stays at its high-water mark; lowering it on removal could leave
+    // populated levels above it, and lookups starting below them miss keys.
+    if(del){
+        v=del->info.second;
+        retire(del);
+        count.sub();
+        sink.ops().pop();
+        return true;
+    }
+    return false;
+
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+template<typename P>
+bool SkipSet<K, V, Alloc, Enable>::findEntry(const P& p, V& v) const{
+    Node* curr=root, *prev=nullptr;
+    
+    EpochGuard guard;
+
+    int r=h;
+    std::uint64_t steps{0};
+    while(r>=0){
+        steps+=updateParams(curr, prev, r, p);
+        Node* next=link(curr, r);
+        if(matches(next, p)){
+            v=next->info.second;
+            sink.ops().traversal(steps);
+            return true;
+        }
+        r--;
+    }
+    sink.ops().traversal(steps);
+    return false;
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+std::ostream& SkipSet<K, V, Alloc, Enable>::printSS(std::ostream& out) const{
+    std::shared_lock<StatSharedMutex> lock{mtx};
+    for(Node* node=link(root, 0); node; node=link(node, 0)){
+        out << "(" << node->info.first << ", " << node->info.second << ")" << "    ";
+    }
+    out << "\n";
+    return out;
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+template<typename P>
+int SkipSet<K, V, Alloc, Enable>::updateParams(Node* &curr, Node* &prev, const int r, const P& p) const{
+    int steps=0;
+    Node* next;
+    while((next=link(curr, r)) && (!prev || (prev && prev!=curr)) && before(next, p)){
+        prev=curr;
+        curr=next;
+        ++steps;
+    }
+    return steps;
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+void SkipSet<K, V, Alloc, Enable>::add(const T& t){
+    Node* curr=root, *prev=nullptr;
+    Node* node=newNode(NodeAlloc(), t, setHeight());
+    Node* finger[sizeof(int)*8+1];
+    const auto probe=Order::probe(node->info.first);
+
+    {
+        std::unique_lock<StatSharedMutex> lock{mtx};
+        int r=h;
+        while(r>=0){
+            updateParams(curr, prev, r, probe);
+            if(matches(link(curr, r), probe)){
+                deleteNode(NodeAlloc(), node);
+                return;
+            }
+            finger[r--]=curr;
+        }
+        sink.ops().push();
+
+        for(int i=0; i<=node->height; ++i){
+            node->next[i].store(link(finger[i], i), std::memory_order_relaxed);
+            finger[i]->next[i].store(node, std::memory_order_release);
+        }
+        count.add();
+    }
+}
+
+// Called with mtx held exclusively.
+template<typename K, typename V, typename Alloc, typename Enable>
+void SkipSet<K, V, Alloc, Enable>::retire(Node* node){
+    limbo.emplace_back(EpochDomain::instance().now(), node);
+    if(limbo.size()>=reclaimBatch) reclaim();
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+void SkipSet<K, V, Alloc, Enable>::reclaim(){
+    const std::uint64_t epoch=EpochDomain::instance().tryAdvance();
+    auto keep=std::partition(limbo.begin(), limbo.end(), [epoch](const std::pair<std::uint64_t, Node*>& r){
+        return !EpochDomain::reclaimable(r.first, epoch);
+    });
+    for(auto it=keep; it!=limbo.end(); ++it) deleteNode(NodeAlloc(), it->second);
+    limbo.erase(keep, limbo.end());
+}
+
+template<typename K, typename V, typename Alloc, typename Enable>
+void SkipSet<K, V, Alloc, Enable>::destroySet(){
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    Node* curr=root;
+    while(curr){
+        Node* tmp=link(curr, 0);
+        deleteNode(NodeAlloc(), curr);
+        curr=tmp;
+    }
+    for(auto& r : limbo) deleteNode(NodeAlloc(), r.second);
+    limbo.clear();
+    h=0;
+}
+
+// Integer keys: an unrolled skip list. Each node holds a sorted group of up to
+// one cache line of keys, padded with the largest K, and the values sit in
+// cells of their own. A lookup hops on the first key of each group and then
+// ranks the whole group with a couple of AVX2 compares. Groups are copy on
+// write: a writer builds the changed group (or the two halves of a full one),
+// swings the links to it and retires the old node, so a lock-free reader
+// always sees a group whole. Appending past the last key splits off a group
+// of one and leaves the full one alone, so keys that arrive in order pack.
+template<typename K, typename V, typename Alloc>
+class SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>{
+    typedef typename std::pair<K, V> T;
+
+    static constexpr int group= sizeof(K)>=4? static_cast<int>(64/sizeof(K)) : 16;
+    static constexpr int maxHeight=sizeof(int)*8;
+    static constexpr std::size_t reclaimBatch=64;
+
+    // Most nodes are at most a few levels tall, so their links sit next to the
+    // keys; only the taller ones pay for a second block.
+    static constexpr int inlineLinks=4;
+
+    struct Node{
+        K keys[group];
+        std::atomic<Node*> low[inlineLinks];
+        std::vector<std::atomic<Node*>, RebindAlloc<Alloc, std::atomic<Node*>>> high;
+        int count;
+        int height;
+        V* vals[group];
+
+        explicit Node(const int hv): high(std::max(0, hv+1-inlineLinks)), count{0}, height{hv} {
+            std::fill(keys, keys+group, std::numeric_limits<K>::max());
+            std::fill(vals, vals+group, nullptr);
+            for(auto& p : low) p.store(nullptr, std::memory_order_relaxed);
+            for(auto& p : high) p.store(nullptr, std::memory_order_relaxed);
+        }
+
+        std::atomic<Node*>& next(const int r){
+            return r<inlineLinks? low[r] : high[r-inlineLinks];
+        }
+
+        const std::atomic<Node*>& next(const int r) const{
+            return r<inlineLinks? low[r] : high[r-inlineLinks];
+        }
+    };
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+    typedef RebindAlloc<Alloc, V> ValueAlloc;
+
+    struct Retired{
+        std::uint64_t epoch;
+        Node* node;
+        V* value;
+    };
+
+    Node* root;
+    std::atomic<int> h;
+    mutable StatSharedMutex mtx;
+    ContainerStatsSink sink;
+    ShardedCounter count;
+    std::vector<Retired> limbo;
+
+    static Node* link(const Node* node, const int r){
+        return node->next(r).load(std::memory_order_acquire);
+    }
+
+#ifdef SKIPSET_AVX2
+    static bool haveAvx2(){
+        static const bool avx2=__builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+    __attribute__((target("avx2")))
+    static int rankAvx2(const K* keys, const K k){
+        int r=0;
+        if constexpr (sizeof(K)==8){
+            const __m256i key=_mm256_set1_epi64x(static_cast<long long>(k));
+            for(int i=0; i<group; i+=4){
+                const __m256i lt=_mm256_cmpgt_epi64(key, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys+i)));
+                r+=__builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+            }
+        }else{
+            const __m256i key=_mm256_set1_epi32(static_cast<int>(k));
+            for(int i=0; i<group; i+=8){
+                const __m256i lt=_mm256_cmpgt_epi32(key, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys+i)));
+                r+=__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+            }
+        }
+        return r;
+    }
+#endif
+
+    // How many keys of the group are below k; the padding never is.
+    static int rank(const Node* node, const K k){
+#ifdef SKIPSET_AVX2
+        if constexpr (std::is_signed_v<K> && (sizeof(K)==8 || sizeof(K)==4)){
+            if(haveAvx2()) return rankAvx2(node->keys, k);
+        }
+#endif
+        int r=0;
+        for(int i=0; i<group; ++i) r+=node->keys[i]<k;
+        return r;
+    }
+
+    int setHeight() const{
+        const int z=std::rand();
+        int m=1;
+        int k=0;
+        while((m & z)){
+            k++;
+            m<<=1;
+        }
+        return k;
+    }
+
+    // Last node on every level whose first key is below k, or root.
+    void findPreds(const K k, Node** preds) const{
+        Node* curr=root;
+        const int top=h.load(std::memory_order_relaxed);
+        for(int r=maxHeight; r>top; --r) preds[r]=root;
+        for(int r=top; r>=0; --r){
+            Node* next;
+            while((next=link(curr, r)) && next->keys[0]<k) curr=next;
+            preds[r]=curr;
+        }
+    }
+
+    // Points every level of old, or of the new nodes, at their replacements.
+    void publish(Node** preds, Node* a, Node* b, const Node* old){
+        for(int i=0; i<=a->height; ++i){
+            a->next(i).store(b && i<=b->height? b : link(old, i), std::memory_order_relaxed);
+        }
+        if(b){
+            for(int i=0; i<=b->height; ++i){
+                b->next(i).store(i<=old->height? link(old, i) : link(preds[i], i), std::memory_order_relaxed);
+            }
+        }
+        for(int i=0; i<=a->height; ++i) preds[i]->next(i).store(a, std::memory_order_release);
+        if(b){
+            for(int i=a->height+1; i<=b->height; ++i) preds[i]->next(i).store(b, std::memory_order_release);
+        }
+        const int top=std::max(a->height, b? b->height : 0);
+        if(top>h.load(std::memory_order_relaxed)) h.store(top, std::memory_order_relaxed);
+    }
+
+    void insertInto(Node* target, Node** preds, const int pos, const K k, V* value);
+    void retire(Node* node, V* value);
+    void reclaim();
+    bool findEntry(const K& k, V& v) const;
+    bool removeEntry(const K& k, V& v);
+    void destroySet();
+
+    std::ostream& printSS(std::ostream& out) const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        for(Node* node=link(root, 0); node; node=link(node, 0)){
+            for(int i=0; i<node->count; ++i) out << "(" << node->keys[i] << ", " << *node->vals[i] << ")" << "    ";
+        }
+        out << "\n";
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const SkipSet& ss){
+        return ss.printSS(out);
+    }
+
+public:
+    SkipSet(): root{newNode(NodeAlloc(), maxHeight)}, h{0} {
+        sink.bind(mtx);
+    }
+
+    ~SkipSet(){
+        destroySet();
+    }
+
+    SkipSet(const SkipSet&)=delete;
+    SkipSet& operator=(const SkipSet&)=delete;
+
+    void add(const T& t);
+
+    bool update(const T& old, const T& t){
+        if(old.first!=t.first || old.second==t.second) return false;
+        V v;
+        if(!findEntry(old.first, v)) return false;
+        removeEntry(old.first, v);
+        add(t);
+        return true;
+    }
+
+    std::shared_ptr<V> find(const K& k) const{
+        V v;
+        return findEntry(k, v)? std::allocate_shared<V>(RebindAlloc<Alloc, V>(), std::move(v)) : std::make_shared<V>();
+    }
+
+    bool find(const K& k, V& v) const{
+        return findEntry(k, v);
+    }
+
+    bool remove(const K& k, V& v){
+        return removeEntry(k, v);
+    }
+
+    std::shared_ptr<V> remove(const K& k){
+        V v;
+        return removeEntry(k, v)? std::allocate_shared<V>(RebindAlloc<Alloc, V>(), std::move(v)) : std::make_shared<V>();
+    }
+
+    template<typename Func>
+    void forRange(const K& lo, const K& hi, Func fn) const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        Node* curr=root;
+        for(int r=h.load(std::memory_order_relaxed); r>=0; --r){
+            Node* next;
+            while((next=link(curr, r)) && next->keys[0]<=lo) curr=next;
+        }
+        for(Node* node= curr==root? link(root, 0) : curr; node; node=link(node, 0)){
+            for(int i=rank(node, lo); i<node->count; ++i){
+                if(hi<node->keys[i]) return;
+                fn(node->keys[i], *node->vals[i]);
+            }
+        }
+    }
+
+    std::map<K, V> getMap() const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        std::map<K, V> res;
+        for(Node* node=link(root, 0); node; node=link(node, 0)){
+            for(int i=0; i<node->count; ++i) res.emplace(node->keys[i], *node->vals[i]);
+        }
+        return res;
+    }
+
+    int size() const{
+        std::shared_lock<StatSharedMutex> lock{mtx};
+        return static_cast<int>(count.size());
+    }
+
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+};
+
+template<typename K, typename V, typename Alloc>
+void SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::add(const T& t){
+    const K k=t.first;
+    Node* preds[maxHeight+1];
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    findPreds(k, preds);
+    Node* first=link(preds[0], 0);
+    if(first && first->keys[0]==k) return;
+
+    if(preds[0]==root && !first){
+        Node* node=newNode(NodeAlloc(), setHeight());
+        node->keys[0]=k;
+        node->vals[0]=newNode(ValueAlloc(), t.second);
+        node->count=1;
+        publish(preds, node, nullptr, root);
+        count.add();
+        sink.ops().push();
+        return;
+    }
+
+    Node* target= preds[0]!=root? preds[0] : first;
+    const int pos=rank(target, k);
+    if(pos<target->count && target->keys[pos]==k) return;
+    if(target==preds[0]) findPreds(target->keys[0], preds);
+    insertInto(target, preds, pos, k, newNode(ValueAlloc(), t.second));
+    count.add();
+    sink.ops().push();
+}
+
+template<typename K, typename V, typename Alloc>
+void SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::insertInto(
+        Node* target, Node** preds, const int pos, const K k, V* value){
+    K keys[group+1];
+    V* vals[group+1];
+    const int n=target->count+1;
+    for(int i=0, j=0; i<n; ++i){
+        if(i==pos){
+            keys[i]=k;
+            vals[i]=value;
+        }else{
+            keys[i]=target->keys[j];
+            vals[i]=target->vals[j++];
+        }
+    }
+
+    const bool split= n>group;
+    const int left= !split? n : (pos==target->count && !link(target, 0))? group : n/2;
+    Node* a=newNode(NodeAlloc(), target->height);
+    std::copy(keys, keys+left, a->keys);
+    std::copy(vals, vals+left, a->vals);
+    a->count=left;
+    Node* b=nullptr;
+    if(split){
+        b=newNode(NodeAlloc(), setHeight());
+        std::copy(keys+left, keys+n, b->keys);
+        std::copy(vals+left, vals+n, b->vals);
+        b->count=n-left;
+    }
+    publish(preds, a, b, target);
+    retire(target, nullptr);
+}
+
+template<typename K, typename V, typename Alloc>
+bool SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::removeEntry(const K& k, V& v){
+    Node* preds[maxHeight+1];
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    findPreds(k, preds);
+    Node* target=link(preds[0], 0);
+    int pos=0;
+    if(!target || target->keys[0]!=k){
+        target=preds[0];
+        if(target==root) return false;
+        pos=rank(target, k);
+        if(pos>=target->count || target->keys[pos]!=k) return false;
+        findPreds(target->keys[0], preds);
+    }
+
+    V* value=target->vals[pos];
+    v=*value;
+    if(target->count==1){
+        for(int i=target->height; i>=0; --i) preds[i]->next(i).store(link(target, i), std::memory_order_release);
+    }else{
+        Node* copy=newNode(NodeAlloc(), target->height);
+        for(int i=0, j=0; i<target->count; ++i){
+            if(i==pos) continue;
+            copy->keys[j]=target->keys[i];
+            copy->vals[j++]=target->vals[i];
+        }
+        copy->count=target->count-1;
+        publish(preds, copy, nullptr, target);
+    }
+    retire(target, value);
+    count.sub();
+    sink.ops().pop();
+    return true;
+}
+
+template<typename K, typename V, typename Alloc>
+bool SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::findEntry(const K& k, V& v) const{
+    EpochGuard guard;
+    Node* curr=root;
+    std::uint64_t steps{0};
+    for(int r=h.load(std::memory_order_relaxed); r>=0; --r){
+        Node* next;
+        while((next=link(curr, r)) && next->keys[0]<=k){
+            curr=next;
+            ++steps;
+        }
+    }
+    sink.ops().traversal(steps);
+    if(curr==root) return false;
+    const int pos=rank(curr, k);
+    if(pos>=curr->count || curr->keys[pos]!=k) return false;
+    v=*curr->vals[pos];
+    return true;
+}
+
+// Called with mtx held exclusively.
+template<typename K, typename V, typename Alloc>
+void SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::retire(Node* node, V* value){
+    limbo.push_back(Retired{EpochDomain::instance().now(), node, value});
+    if(limbo.size()>=reclaimBatch) reclaim();
+}
+
+template<typename K, typename V, typename Alloc>
+void SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::reclaim(){
+    const std::uint64_t epoch=EpochDomain::instance().tryAdvance();
+    auto keep=std::partition(limbo.begin(), limbo.end(), [epoch](const Retired& r){
+        return !EpochDomain::reclaimable(r.epoch, epoch);
+    });
+    for(auto it=keep; it!=limbo.end(); ++it){
+        deleteNode(ValueAlloc(), it->value);
+        deleteNode(NodeAlloc(), it->node);
+    }
+    limbo.erase(keep, limbo.end());
+}
+
+template<typename K, typename V, typename Alloc>
+void SkipSet<K, V, Alloc, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>>::destroySet(){
+    std::unique_lock<StatSharedMutex> lock{mtx};
+    Node* curr=root;
+    while(curr){
+        Node* tmp=link(curr, 0);
+        for(int i=0; i<curr->count; ++i) deleteNode(ValueAlloc(), curr->vals[i]);
+        deleteNode(NodeAlloc(), curr);
+        curr=tmp;
+    }
+    for(auto& r : limbo){
+        deleteNode(ValueAlloc(), r.value);
+        deleteNode(NodeAlloc(), r.node);
+    }
+    limbo.clear();
+}
+ 
+#endif
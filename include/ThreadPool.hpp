@@ -0,0 +1,53 @@
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ThreadSafeQueue.hpp"
+
+// Fixed set of workers draining one ThreadSafeQueue of tasks. Shutdown closes
+// the queue, so queued work finishes before join.
+class ThreadPool{
+    ThreadSafeQueue<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+
+    void work(){
+        std::function<void()> task;
+        while(tasks.waitAndDequeue(task)) task();
+    }
+
+public:
+    explicit ThreadPool(unsigned int n=std::thread::hardware_concurrency()){
+        if(n==0) n=1;
+        for(unsigned int i=0; i<n; ++i) workers.emplace_back(&ThreadPool::work, this);
+    }
+
+    ~ThreadPool(){
+        tasks.close();
+        for(auto& w : workers){
+            if(w.joinable()) w.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&)=delete;
+    ThreadPool& operator=(const ThreadPool&)=delete;
+
+    template<typename Fn>
+    std::future<std::invoke_result_t<Fn>> submit(Fn fn){
+        auto task=std::make_shared<std::packaged_task<std::invoke_result_t<Fn>()>>(std::move(fn));
+        std::future<std::invoke_result_t<Fn>> res=task->get_future();
+        tasks.push([task]{ (*task)(); });
+        return res;
+    }
+
+    std::size_t size() const{
+        return workers.size();
+    }
+};
+
+#endif
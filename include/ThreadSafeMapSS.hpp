@@ -0,0 +1,134 @@
+#ifndef _THREADSAFEMAPSS_H_
+#define _THREADSAFEMAPSS_H_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+
+#include "SkipSet.hpp"
+
+// std::hash, except that string keys hash through string_view, which gives the
+// same value, so finding by a string_view or const char* picks the same bucket
+// without building a std::string.
+template<typename K>
+struct KeyHash: std::hash<K> {};
+
+template<>
+struct KeyHash<std::string>{
+    std::size_t operator()(const std::string_view s) const{
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+template<typename K, typename V, typename H=KeyHash<K>, typename Alloc=PoolAllocator<std::pair<K, V>>>
+class ThreadSafeMapSS{
+private:
+    struct Bucket{
+        SkipSet<K, V, Alloc> bucket_data;
+
+        template<typename Q>
+        std::shared_ptr<V> find(const Q& k) const{
+            return bucket_data.find(k);
+        }
+
+        void add_or_update(const K& k, const V& v){
+            V old;
+            if(bucket_data.find(k, old)){
+                bucket_data.update(std::pair<K, V>(k, old), std::pair<K, V>(k, v));
+            }else{
+                bucket_data.add(std::pair<K, V>(k, v));
+            }
+        }
+
+        template<typename Q>
+        std::shared_ptr<V> remove(const Q& k){
+            return bucket_data.remove(k);
+        }
+
+        std::size_t size() const{
+            return static_cast<std::size_t>(bucket_data.size());
+        }
+
+        std::size_t approxSize() const{
+            return bucket_data.approxSize();
+        }
+
+        ContainerStats stats() const{
+            return bucket_data.stats();
+        }
+
+        std::ostream& print(std::ostream& out) const{
+            out << bucket_data;
+            return out;
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const Bucket& bucket){
+            return bucket.print(out);
+        }
+    };
+    std::vector<std::unique_ptr<Bucket>> buckets;
+    H hasher;
+
+    template<typename Q>
+    Bucket& getBucket(const Q& k) const{
+        std::size_t ind{hasher(k)%buckets.size()};
+        return *buckets[ind];
+    }
+
+    std::ostream& print(std::ostream& out) const{
+        for(std::size_t i=0; i<buckets.size(); out << *buckets[i], ++i);
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const ThreadSafeMapSS& tsm){
+        return tsm.print(out);
+    }
+
+public:
+    ThreadSafeMapSS(unsigned int numBuckets = 7, const H& hasher_=H()): buckets(numBuckets), hasher{hasher_} {
+        for(unsigned int i{0}; i<numBuckets; ++i){
+            buckets[i].reset(new Bucket);
+        }
+    }
+
+    void add_or_update(const K& k, const V& v){
+        getBucket(k).add_or_update(k, v);
+    }
+
+    // Q is K, or for string keys anything that views as a string_view.
+    template<typename Q=K>
+    std::shared_ptr<V> remove(const Q& k){
+        return getBucket(k).remove(k);
+    }
+
+    template<typename Q=K>
+    std::shared_ptr<V> find(const Q& k) const{
+        return getBucket(k).find(k);
+    }
+
+    // Exact per bucket; buckets are read one after another, not at one instant.
+    std::size_t size() const{
+        std::size_t res{0};
+        for(auto& b : buckets) res+=b->size();
+        return res;
+    }
+
+    // Lock-free; may lag writers still in flight.
+    std::size_t approxSize() const{
+        std::size_t res{0};
+        for(auto& b : buckets) res+=b->approxSize();
+        return res;
+    }
+
+    ContainerStats stats() const{
+        ContainerStats res;
+        for(auto& b : buckets) res.merge(b->stats());
+        return res;
+    }
+    
+};
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef _THREADSAFEQUEUE_H_
+#define _THREADSAFEQUEUE_H_
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include "NodePool.hpp"
+#include "LockStats.hpp"
+#include "ShardedCounter.hpp"
+#include "QueueWait.hpp"
+
+// Blocking pops poll briefly and then park; they return empty-handed only once
+// the queue is closed and drained, or when their deadline or stop token says
+// so. push only touches the condition variable when someone is parked.
+template<typename T, typename Alloc=PoolAllocator<T>>
+class ThreadSafeQueue{
+private:
+    struct Node;
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+    typedef std::unique_ptr<Node, NodeDeleter<NodeAlloc>> NodePtr;
+
+    struct Node{
+        std::shared_ptr<T> data;
+        NodePtr next;
+    };
+    Node* tail;
+    NodePtr head;
+    mutable StatMutex mtxH;
+    mutable StatMutex mtxT;
+    StatCondVar cv;
+    ShardedCounter count;
+    ContainerStatsSink sink;
+    std::atomic<bool> closed{false};
+    std::atomic<int> parked{0};
+    SpinThenPark spinner;
+    QueueWatchers watchers;
+
+    Node* getTail() const{
+        std::lock_guard<StatMutex> lock{mtxT};
+        return tail;
+    }
+
+    NodePtr popHead(){
+        NodePtr oldHead{std::move(head)};
+        head=std::move(oldHead->next);
+        count.sub();
+        sink.ops().pop();
+        return oldHead;
+    }
+
+    bool hasData() const{
+        return head.get()!=getTail();
+    }
+
+    // Returns holding mtxH once there is data or the queue is closed, or
+    // once park(lock, pred) gives up. The parked count is raised under mtxH
+    // before the last check, and push notifies under mtxH when it sees it,
+    // so no wakeup is lost between the check and the wait.
+    template<typename Park>
+    std::unique_lock<StatMutex> waitForData(Park park){
+        spinner.spin([this]{
+            return count.load()>0 || closed.load(std::memory_order_acquire);
+        });
+        auto ready=[this]{
+            return hasData() || closed.load(std::memory_order_acquire);
+        };
+        std::unique_lock<StatMutex> lock{mtxH};
+        if(ready()) return lock;
+        parked.fetch_add(1);
+        park(lock, ready);
+        parked.fetch_sub(1);
+        return lock;
+    }
+
+    template<typename Park>
+    NodePtr waitDequeue(Park park){
+        std::unique_lock<StatMutex> lock{waitForData(park)};
+        return hasData()? popHead() : NodePtr();
+    }
+
+    template<typename Park>
+    NodePtr waitDequeue(T& val, Park park){
+        std::unique_lock<StatMutex> lock{waitForData(park)};
+        if(!hasData()) return NodePtr();
+        val=std::move(*(head->data));
+        return popHead();
+    }
+
+    void wake(const bool all){
+        if(parked.load()==0) return;
+        {
+            std::lock_guard<StatMutex> lock{mtxH};
+        }
+        if(all) cv.notify_all();
+        else cv.notify_one();
+    }
+
+    NodePtr tryPopHead(){
+        std::unique_lock<StatMutex> lock{mtxH};
+        if(head.get()==getTail()){
+            sink.ops().retry();
+            return NodePtr();
+        }
+        return popHead();
+    }
+
+    NodePtr tryPopHead(T& val){
+        std::unique_lock<StatMutex> lock{mtxH};
+        if(head.get()==getTail()){
+            sink.ops().retry();
+            return NodePtr();
+        }
+        val=std::move(*(head->data));
+        return popHead();
+    }
+
+public:
+    ThreadSafeQueue(): head{newNode(NodeAlloc())}{
+        tail=head.get();
+        sink.bind(mtxH);
+        sink.bind(mtxT);
+    }
+    ThreadSafeQueue(const ThreadSafeQueue& tsq)=delete;
+    ThreadSafeQueue& operator=(const ThreadSafeQueue& tsq)=delete;
+
+    bool isEmpty() const{
+        std::lock_guard<StatMutex> lock{mtxH};
+        return (head.get() == getTail());
+    }
+
+    // Throws QueueClosedException after close().
+    void push(T newVal){
+        std::shared_ptr<T> val{std::allocate_shared<T>(Alloc(), std::move(newVal))};
+        NodePtr p{newNode(NodeAlloc())};
+        {
+            std::lock_guard<StatMutex> lock{mtxT};
+            if(closed.load(std::memory_order_relaxed)) throw QueueClosedException();
+            tail->data=val;
+            Node* newTail=p.get();
+            tail->next=std::move(p);
+            tail=newTail;
+            count.add();
+        }
+        sink.ops().push();
+        wake(false);
+        watchers.notify();
+    }
+
+    // Refuses further pushes; what is queued can still be dequeued, and
+    // blocking pops return empty once it is gone.
+    void close(){
+        {
+            std::lock_guard<StatMutex> lock{mtxT};
+            closed.store(true, std::memory_order_release);
+        }
+        wake(true);
+        watchers.notify();
+    }
+
+    bool isClosed() const{
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // w is notified after every push and on close, until detached.
+    void attach(QueueNotifier* w){
+        watchers.attach(w);
+    }
+
+    void detach(QueueNotifier* w){
+        watchers.detach(w);
+    }
+
+    // Exact: holds both ends still while it reads the count.
+    size_t size() const{
+        std::lock_guard<StatMutex> lock{mtxH};
+        std::lock_guard<StatMutex> lockT{mtxT};
+        return count.size();
+    }
+
+    // Lock-free; may lag pushes and pops still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    // nullptr once the queue is closed and drained.
+    std::shared_ptr<T> waitAndDequeue(){
+        NodePtr oldHead{waitDequeue([this](auto& lock, auto pred){ cv.wait(lock, pred); })};
+        return oldHead? oldHead->data : std::shared_ptr<T>();
+    }
+
+    // false once the queue is closed and drained.
+    bool waitAndDequeue(T& val){
+        NodePtr oldHead{waitDequeue(val, [this](auto& lock, auto pred){ cv.wait(lock, pred); })};
+        return oldHead? true : false;
+    }
+
+    // false on timeout, or once the queue is closed and drained.
+    template<typename Rep, typename Period>
+    bool waitFor(T& val, const std::chrono::duration<Rep, Period>& timeout){
+        return waitUntil(val, std::chrono::steady_clock::now()+timeout);
+    }
+
+    template<typename Clock, typename Duration>
+    bool waitUntil(T& val, const std::chrono::time_point<Clock, Duration>& deadline){
+        NodePtr oldHead{waitDequeue(val, [this, &deadline](auto& lock, auto pred){ cv.wait_until(lock, deadline, pred); })};
+        return oldHead? true : false;
+    }
+
+#ifdef QUEUE_STOP_TOKEN
+    // false once stop is requested, or once the queue is closed and drained.
+    bool waitAndDequeue(T& val, std::stop_token stop){
+        std::stop_callback onStop(stop, [this]{
+            {
+                std::lock_guard<StatMutex> lock{mtxH};
+            }
+            cv.notify_all();
+        });
+        NodePtr oldHead{waitDequeue(val, [this, &stop](auto& lock, auto pred){
+            cv.wait(lock, [&]{ return pred() || stop.stop_requested(); });
+        })};
+        return oldHead? true : false;
+    }
+#endif
+
+    std::shared_ptr<T> tryDequeue(){
+        NodePtr oldHead{tryPopHead()};
+        return oldHead? oldHead->data : std::make_shared<T>();
+    }
+
+    bool tryDequeue(T& val){
+        NodePtr oldHead{tryPopHead(val)};
+        return oldHead? true : false;
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+
+};
+
+#endif
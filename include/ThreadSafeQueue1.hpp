@@ -0,0 +1,183 @@
+#ifndef _THREADSAFEQUEUE1_H_
+#define _THREADSAFEQUEUE1_H_
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include "ShardedCounter.hpp"
+#include "QueueWait.hpp"
+
+// Same waiting rules as ThreadSafeQueue: poll, then park; blocking pops come
+// back empty only when closed and drained, timed out or stopped.
+template<typename T>
+class ThreadSafeQueue1{
+    std::deque<T> data;
+    std::condition_variable cv;
+    mutable std::mutex mtx;
+    ShardedCounter count;
+    bool closed{false};
+    int parked{0};
+    SpinThenPark spinner;
+    QueueWatchers watchers;
+
+    // Returns holding mtx with data, or empty-handed once park(lock, pred)
+    // gives up or the queue is closed and drained.
+    template<typename Park>
+    std::unique_lock<std::mutex> waitForData(Park park){
+        spinner.spin([this]{
+            return count.load()>0;
+        });
+        auto ready=[this]{
+            return !data.empty() || closed;
+        };
+        std::unique_lock<std::mutex> lock{mtx};
+        if(!ready()){
+            ++parked;
+            park(lock, ready);
+            --parked;
+        }
+        return lock;
+    }
+
+    template<typename Park>
+    bool waitPop(T& val, Park park){
+        std::unique_lock<std::mutex> lock{waitForData(park)};
+        if(data.empty()) return false;
+        val=std::move(data.back());
+        data.pop_back();
+        count.sub();
+        return true;
+    }
+
+    std::ostream& print(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock{mtx};
+        for(auto& e : data) out << e << "  ";
+        out << "\n";
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const ThreadSafeQueue1& tsq){
+        return tsq.print(out);
+    }
+
+public:
+    ThreadSafeQueue1(){}
+    ThreadSafeQueue1(const ThreadSafeQueue1& tsq){
+        std::lock_guard<std::mutex> lock{tsq.mtx};
+        data=tsq.data;
+        count.add(static_cast<std::int64_t>(data.size()));
+    }
+
+    ThreadSafeQueue1& operator=(const ThreadSafeQueue1& tsq)=delete;
+
+    // Throws QueueClosedException after close().
+    void push(T val){
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            if(closed) throw QueueClosedException();
+            data.push_front(std::move(val));
+            count.add();
+            if(parked) cv.notify_one();
+        }
+        watchers.notify();
+    }
+
+    // Refuses further pushes; what is queued can still be popped.
+    void close(){
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            closed=true;
+            cv.notify_all();
+        }
+        watchers.notify();
+    }
+
+    bool isClosed() const{
+        std::lock_guard<std::mutex> lock{mtx};
+        return closed;
+    }
+
+    // w is notified after every push and on close, until detached.
+    void attach(QueueNotifier* w){
+        watchers.attach(w);
+    }
+
+    void detach(QueueNotifier* w){
+        watchers.detach(w);
+    }
+
+    // nullptr once the queue is closed and drained.
+    std::shared_ptr<T> wait_and_pop(){
+        T val;
+        return wait_and_pop(val)? std::make_shared<T>(std::move(val)) : std::shared_ptr<T>();
+    }
+
+    // false once the queue is closed and drained.
+    bool wait_and_pop(T& val){
+        return waitPop(val, [this](auto& lock, auto pred){ cv.wait(lock, pred); });
+    }
+
+    // false on timeout, or once the queue is closed and drained.
+    template<typename Rep, typename Period>
+    bool wait_for(T& val, const std::chrono::duration<Rep, Period>& timeout){
+        return wait_until(val, std::chrono::steady_clock::now()+timeout);
+    }
+
+    template<typename Clock, typename Duration>
+    bool wait_until(T& val, const std::chrono::time_point<Clock, Duration>& deadline){
+        return waitPop(val, [this, &deadline](auto& lock, auto pred){ cv.wait_until(lock, deadline, pred); });
+    }
+
+#ifdef QUEUE_STOP_TOKEN
+    // false once stop is requested, or once the queue is closed and drained.
+    bool wait_and_pop(T& val, std::stop_token stop){
+        std::stop_callback onStop(stop, [this]{
+            std::lock_guard<std::mutex> lock{mtx};
+            cv.notify_all();
+        });
+        return waitPop(val, [this, &stop](auto& lock, auto pred){
+            cv.wait(lock, [&]{ return pred() || stop.stop_requested(); });
+        });
+    }
+#endif
+
+    std::shared_ptr<T> tryPop() {
+        std::lock_guard<std::mutex> lock{mtx};
+        if(data.empty()) return std::make_shared<T>();
+        std::shared_ptr<T> res{std::make_shared<T>(std::move(data.back()))};
+        data.pop_back();
+        count.sub();
+        return res;
+    }
+
+    bool tryPop(T& val) {
+        std::lock_guard<std::mutex> lock{mtx};
+        if(data.empty()) return false;
+        val=std::move(data.back());
+        data.pop_back();
+        count.sub();
+        return true;
+    }
+
+    bool isEmpty() const {
+        std::lock_guard<std::mutex> lock{mtx};
+        return data.empty();
+    }
+
+    std::size_t size() const{
+        std::lock_guard<std::mutex> lock{mtx};
+        return data.size();
+    }
+
+    // Lock-free; may lag pushes and pops still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+};
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef _THREADSAFESLIST_H_
+#define _THREADSAFESLIST_H_
+
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <string>
+#include <exception>
+#include <deque>
+#include <vector>
+#include <future>
+#include <algorithm>
+
+#include "NodePool.hpp"
+#include "LockStats.hpp"
+#include "ShardedCounter.hpp"
+#include "ThreadPool.hpp"
+
+class EmptyListException: public std::exception{
+    std::string msg;
+public:
+    EmptyListException(std::string message="List is empy"): msg{std::move(message)} {}
+    virtual const char* what() const noexcept override{
+        return msg.c_str();
+    }
+};
+
+// Every segmentLength pushes, push_front also puts an empty marker node in
+// front, and the markers are listed, newest first, in a registry. The parallel
+// traversals cut the list at the markers and walk the pieces on a pool, hand
+// over hand, while writers go on. remove_if drops markers whose segment has
+// emptied. A marker is never dropped while a parallel traversal holds the
+// registry. Writers only try to take the registry, so they never wait on a
+// traversal and never block one.
+template<typename T, typename Alloc=PoolAllocator<T>>
+class ThreadSafeSList{
+    struct Node;
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+    typedef std::unique_ptr<Node, NodeDeleter<NodeAlloc>> NodePtr;
+
+    struct Node{
+        std::shared_ptr<T> data;
+        NodePtr next;
+        mutable StatMutex mtx;
+
+        Node(): next() {}
+        Node(T val): data{std::allocate_shared<T>(Alloc(), std::move(val))} {}
+    };
+
+    static constexpr std::size_t segmentLength=256;
+
+    mutable Node head;
+    ShardedCounter count;
+    mutable StatMutex mtx;
+    ContainerStatsSink sink;
+    std::deque<Node*> markers;
+    std::size_t sinceMarker{0};
+    mutable std::shared_mutex markerMtx;
+
+    static bool isMarker(const Node* node){
+        return !node->data;
+    }
+
+    // Runs fn on every element strictly between from and to, which must be
+    // head, a listed marker or nullptr.
+    template<typename Func>
+    std::uint64_t walk(const Node* from, const Node* to, Func& fn) const;
+
+    template<typename Acc, typename Seg>
+    std::vector<Acc> forSegments(Seg seg, ThreadPool& pool) const;
+
+    std::ostream& print(std::ostream& out) const{
+        std::lock_guard<StatMutex> lock{mtx};
+        forEach([&out](const T& t){
+            out << t << "  ";
+        });
+        out << "\n";
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const ThreadSafeSList& tsl){
+        return tsl.print(out);
+    }
+
+public:
+    ThreadSafeSList(){
+        sink.bind(mtx);
+        sink.bind(head.mtx);
+    }
+    ThreadSafeSList(const ThreadSafeSList& tsl)=delete;
+    ThreadSafeSList& operator=(const ThreadSafeSList& tsl)=delete;
+    ~ThreadSafeSList(){
+        remove_if([](const T&){
+            return true;
+        });
+    }
+
+    void push_front(T val);
+
+    template<typename Func>
+    void forEach(Func func) const;
+
+    template<typename Func>
+    bool find_first_if(Func func) const;
+
+    template<typename Func>
+    void remove_if(Func func);
+
+    // fn(const T&) on every element, several segments at once on pool, so fn
+    // must be safe to call concurrently. Elements present for the whole call
+    // are seen exactly once; ones pushed or removed meanwhile may or may not be.
+    template<typename Func>
+    void parallel_for_each(Func fn, ThreadPool& pool) const;
+
+    // Same guarantees as parallel_for_each.
+    template<typename Pred>
+    std::size_t parallel_count_if(Pred pred, ThreadPool& pool) const;
+
+    std::size_t countElem(const T& t) const{
+        std::lock_guard<StatMutex> lock{mtx};
+        std::size_t res{0};
+        forEach([&res, t](const T& val){
+            if(t==val) res++;
+        });
+        return res;
+    }
+
+    // Exact: counts the nodes hand over hand while holding the head, so it
+    // trails any remove_if already under way and nothing new can start.
+    std::size_t size() const{
+        std::lock_guard<StatMutex> headLock{head.mtx};
+        std::unique_lock<StatMutex> lock;
+        std::size_t res{0};
+        for(Node* node=head.next.get(); node; node=node->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            lock=std::move(nxtLock);
+            res+=!isMarker(node);
+        }
+        return res;
+    }
+
+    // Lock-free; may lag pushes and removals still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+
+};
+
+template<typename T, typename Alloc>
+template<typename Func>
+void ThreadSafeSList<T, Alloc>::remove_if(Func func){
+    Node* curr=&head;
+    std::unique_lock<StatMutex> lock{head.mtx};
+    if(!head.next) throw EmptyListException();
+    std::uint64_t steps{0};
+    while(Node* node=curr->next.get()){
+        std::unique_lock<StatMutex> nxtLock{node->mtx};
+        ++steps;
+
+        if(isMarker(node)){
+            std::unique_lock<std::shared_mutex> reg{markerMtx, std::try_to_lock};
+            if((curr==&head || isMarker(curr)) && reg){
+                markers.erase(std::find(markers.begin(), markers.end(), node));
+                NodePtr old{std::move(curr->next)};
+                curr->next=std::move(node->next);
+                nxtLock.unlock();
+                continue;
+            }
+        }
+        if(!isMarker(node) && func(*node->data)){
+            NodePtr old{std::move(curr->next)};
+            curr->next=std::move(node->next);
+            count.sub();
+            nxtLock.unlock();
+            sink.ops().pop();
+        }else{
+            lock.unlock();
+            curr=node;
+            lock=std::move(nxtLock);
+        }
+    }
+    sink.ops().traversal(steps);
+}
+
+template<typename T, typename Alloc>
+template<typename Func>
+bool ThreadSafeSList<T, Alloc>::find_first_if(Func func) const{
+    Node* curr=&head;
+    std::unique_lock<StatMutex> lock{head.mtx};
+    std::uint64_t steps{0};
+    while(Node* node=curr->next.get()){
+        std::unique_lock<StatMutex> nxtLock{node->mtx};
+        lock.unlock();
+        ++steps;
+        if(!isMarker(node) && func(*node->data)){
+            sink.ops().traversal(steps);
+            return true;
+        }else{
+            curr=node;
+            lock=std::move(nxtLock);
+        }
+    }
+    sink.ops().traversal(steps);
+    return false;
+}
+
+template<typename T, typename Alloc>
+template<typename Func>
+void ThreadSafeSList<T, Alloc>::forEach(Func func) const {
+    Node* curr=&head;
+    std::unique_lock<StatMutex> lock{head.mtx};
+    std::uint64_t steps{0};
+    while(Node* node=curr->next.get()){
+        std::unique_lock<StatMutex> nxtLock{node->mtx};
+        lock.unlock();
+        if(!isMarker(node)) func(*node->data);
+        curr=node;
+        lock=std::move(nxtLock);
+        ++steps;
+    }
+    sink.ops().traversal(steps);
+}
+
+template<typename T, typename Alloc>
+void ThreadSafeSList<T, Alloc>::push_front(T val){
+    NodePtr node{newNode(NodeAlloc(), std::move(val))};
+    sink.bind(node->mtx);
+    std::lock_guard<StatMutex> lock{head.mtx};
+    if(++sinceMarker>=segmentLength){
+        std::unique_lock<std::shared_mutex> reg{markerMtx, std::try_to_lock};
+        if(reg){
+            NodePtr marker{newNode(NodeAlloc())};
+            sink.bind(marker->mtx);
+            marker->next=std::move(head.next);
+            head.next=std::move(marker);
+            markers.push_front(head.next.get());
+            sinceMarker=0;
+        }
+    }
+    node->next=std::move(head.next);
+    head.next=std::move(node);
+    count.add();
+    sink.ops().push();
+}
+
+template<typename T, typename Alloc>
+template<typename Func>
+std::uint64_t ThreadSafeSList<T, Alloc>::walk(const Node* from, const Node* to, Func& fn) const{
+    const Node* curr=from;
+    std::unique_lock<StatMutex> lock{curr->mtx};
+    std::uint64_t steps{0};
+    while(const Node* node=curr->next.get()){
+        if(node==to) break;
+        std::unique_lock<StatMutex> nxtLock{node->mtx};
+        lock.unlock();
+        if(!isMarker(node)) fn(*node->data);
+        curr=node;
+        lock=std::move(nxtLock);
+        ++steps;
+    }
+    return steps;
+}
+
+// seg(from, to) for runs of consecutive segments, a few per pool worker, with
+// the registry held shared so none of the bounds can go away.
+template<typename T, typename Alloc>
+template<typename Acc, typename Seg>
+std::vector<Acc> ThreadSafeSList<T, Alloc>::forSegments(Seg seg, ThreadPool& pool) const{
+    std::shared_lock<std::shared_mutex> reg{markerMtx};
+    std::vector<const Node*> bounds{&head};
+    bounds.insert(bounds.end(), markers.begin(), markers.end());
+    bounds.push_back(nullptr);
+
+    const std::size_t segments=bounds.size()-1;
+    const std::size_t tasks=std::min<std::size_t>(segments, std::max<std::size_t>(1, pool.size()*4));
+    std::vector<std::future<Acc>> parts;
+    for(std::size_t t=0; t<tasks; ++t){
+        const Node* from=bounds[segments*t/tasks];
+        const Node* to=bounds[segments*(t+1)/tasks];
+        parts.push_back(pool.submit([&seg, from, to]{ return seg(from, to); }));
+    }
+    std::vector<Acc> res;
+    std::exception_ptr err;
+    for(auto& p : parts){
+        try{
+            res.push_back(p.get());
+        }catch(...){
+            if(!err) err=std::current_exception();
+        }
+    }
+    if(err) std::rethrow_exception(err);
+    return res;
+}
+
+template<typename T, typename Alloc>
+template<typename Func>
+void ThreadSafeSList<T, Alloc>::parallel_for_each(Func fn, ThreadPool& pool) const{
+    const auto steps=forSegments<std::uint64_t>([this, &fn](const Node* from, const Node* to){
+        return walk(from, to, fn);
+    }, pool);
+    std::uint64_t total{0};
+    for(const auto s : steps) total+=s;
+    sink.ops().traversal(total);
+}
+
+template<typename T, typename Alloc>
+template<typename Pred>
+std::size_t ThreadSafeSList<T, Alloc>::parallel_count_if(Pred pred, ThreadPool& pool) const{
+    const auto parts=forSegments<std::pair<std::size_t, std::uint64_t>>([this, &pred](const Node* from, const Node* to){
+        std::size_t n{0};
+        auto fn=[&n, &pred](const T& t){
+            if(pred(t)) ++n;
+        };
+        const std::uint64_t steps=walk(from, to, fn);
+        return std::make_pair(n, steps);
+    }, pool);
+    std::size_t res{0};
+    std::uint64_t steps{0};
+    for(const auto& p : parts){
+        res+=p.first;
+        steps+=p.second;
+    }
+    sink.ops().traversal(steps);
+    return res;
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef _THREADSAFESORTLIST_H_
+#define _THREADSAFESORTLIST_H_
+
+#include <iostream>
+#include <mutex>
+#include <memory>
+
+#include "NodePool.hpp"
+#include "LockStats.hpp"
+#include "ShardedCounter.hpp"
+
+template<typename T, typename Alloc=PoolAllocator<T>>
+class ThreadSafeSorteList{
+    struct Node;
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+    typedef std::unique_ptr<Node, NodeDeleter<NodeAlloc>> NodePtr;
+
+    struct Node{
+        std::shared_ptr<T> data;
+        NodePtr next;
+        StatMutex mtx;
+
+        Node(): next() {}
+        Node(T t): data{std::allocate_shared<T>(Alloc(), std::move(t))} {}
+    };
+    Node head;
+    ShardedCounter count;
+    ContainerStatsSink sink;
+
+    std::ostream& print(std::ostream& out){
+        forEach([&out](const T& t){
+            out << t << "  ";
+        });
+        out << "\n";
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, ThreadSafeSorteList& tss){
+        return tss.print(out);
+    }
+
+public:
+    ThreadSafeSorteList(){
+        sink.bind(head.mtx);
+    }
+
+    void add(T t){
+        NodePtr newNode{::newNode(NodeAlloc(), t)};
+        sink.bind(newNode->mtx);
+        sink.ops().push();
+        std::unique_lock<StatMutex> lock{head.mtx};
+
+        Node* curr=&head;
+        std::uint64_t steps{0};
+        while(Node* node=curr->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            ++steps;
+            if(*(node->data) > t) break;
+            lock.unlock();
+            curr=node;
+            lock=std::move(nxtLock);
+        }
+        newNode->next=std::move(curr->next);
+        curr->next=std::move(newNode);
+        count.add();
+        sink.ops().traversal(steps);
+    }
+
+    bool remove(const T& t){
+        std::unique_lock<StatMutex> lock{head.mtx};
+        if(!head.next) return false;
+        Node* curr=&head;
+        bool removed{false};
+        std::uint64_t steps{0};
+        while(Node* node=curr->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            ++steps;
+            if(*node->data < t){
+                lock.unlock();
+                curr=node;
+                lock=std::move(nxtLock);
+            }else if(*node->data == t){
+                NodePtr oldNode{std::move(curr->next)};
+                curr->next=std::move(node->next);
+                nxtLock.unlock();
+                count.sub();
+                removed=true;
+                sink.ops().pop();
+            }else{
+                break;
+            }
+        }
+        sink.ops().traversal(steps);
+        return removed;
+    }
+
+    bool find(const T& t){
+        std::unique_lock<StatMutex> lock{head.mtx};
+        if(!head.next) return false;
+        Node* curr=&head;
+        std::uint64_t steps{0};
+        while(Node* node=curr->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            lock.unlock();
+            ++steps;
+            if(*node->data < t){
+               curr=node;
+               lock=std::move(nxtLock); 
+            }else if(*node->data==t){
+                sink.ops().traversal(steps);
+                return true;
+            }else {
+                break;
+            }
+        }
+        sink.ops().traversal(steps);
+        return false;
+    }
+
+    template<typename Func>
+    void forEach(Func func){
+        Node* curr=&head;
+        std::unique_lock<StatMutex> lock{head.mtx};
+        std::uint64_t steps{0};
+        while(Node* node=curr->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            lock.unlock();
+            func(*node->data);
+            curr=node;
+            lock=std::move(nxtLock);
+            ++steps;
+        }
+        sink.ops().traversal(steps);
+    }
+
+    // Exact: counts the nodes hand over hand behind any writer already in the list.
+    std::size_t size(){
+        std::lock_guard<StatMutex> headLock{head.mtx};
+        std::unique_lock<StatMutex> lock;
+        std::size_t res{0};
+        for(Node* node=head.next.get(); node; node=node->next.get()){
+            std::unique_lock<StatMutex> nxtLock{node->mtx};
+            lock=std::move(nxtLock);
+            ++res;
+        }
+        return res;
+    }
+
+    // Lock-free; may lag adds and removals still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _THREADSAFESTACK_H_
+#define _THREADSAFESTACK_H_
+
+#include <iostream>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <exception>
+
+#include "NodePool.hpp"
+#include "LockStats.hpp"
+#include "ShardedCounter.hpp"
+
+class EmptyStackException: public std::exception{
+    std::string msg;
+public:
+    EmptyStackException(std::string str="Stack is empty"): msg{std::move(str)} {}
+    virtual const char* what() const noexcept override{
+        return msg.c_str();
+    }
+};
+
+template<typename T, typename Alloc=PoolAllocator<T>>
+class ThreadSafeStack{
+    struct Node;
+    typedef RebindAlloc<Alloc, Node> NodeAlloc;
+    typedef std::unique_ptr<Node, NodeDeleter<NodeAlloc>> NodePtr;
+
+    struct Node{
+        std::shared_ptr<T> data;
+        NodePtr next;
+        mutable StatMutex mtx;
+
+        Node(): next() {}
+        explicit Node(T val): data{std::allocate_shared<T>(Alloc(), std::move(val))} {}
+    };
+
+    mutable StatMutex stackMtx;
+    Node head;
+    ShardedCounter count;
+    ContainerStatsSink sink;
+
+    friend std::ostream& operator<<(std::ostream& out, ThreadSafeStack& stack){
+        return stack.printStack(out);
+    }
+
+    std::ostream& printStack(std::ostream& out){
+        Node* curr=&head;
+        std::unique_lock<StatMutex> lock{stackMtx};
+        std::uint64_t steps{0};
+        while(Node* node=curr->next.get()){
+            out << *node->data << "  ";
+            curr=node;
+            ++steps;
+        }
+        sink.ops().traversal(steps);
+        out << "\n";
+        return out;
+    }
+
+    std::shared_ptr<T> popItem(){
+        Node* curr=&head;
+        std::unique_lock<StatMutex> lock{head.mtx};
+        if(!head.next){
+            sink.ops().retry();
+            throw EmptyStackException();
+        }
+        Node* node=curr->next.get();
+        std::shared_ptr<T> res{node->data};
+        NodePtr old{std::move(curr->next)};
+        head.next=std::move(node->next);
+        count.sub();
+        sink.ops().pop();
+        return res;
+    }
+
+public:
+    ThreadSafeStack(){
+        sink.bind(stackMtx);
+        sink.bind(head.mtx);
+    }
+    ThreadSafeStack(const ThreadSafeStack& tss) = delete;
+    ThreadSafeStack& operator=(const ThreadSafeStack& tss) = delete;
+
+    void push(T val){
+        NodePtr node{newNode(NodeAlloc(), std::move(val))};
+        std::lock_guard<StatMutex> lock{head.mtx};
+        node->next=std::move(head.next);
+        head.next=std::move(node);
+        count.add();
+        sink.ops().push();
+    }
+
+    std::shared_ptr<T> pop(){
+        return popItem();
+    }
+
+    void pop(T& val){
+        std::shared_ptr<T> res{popItem()};
+        val=*res;
+    }
+
+    bool isEmpty() const{
+        std::lock_guard<StatMutex> lock{head.mtx};
+        return !head.next;
+    }
+
+    std::size_t size() const{
+        std::lock_guard<StatMutex> lock{head.mtx};
+        return count.size();
+    }
+
+    // Lock-free; may lag pushes and pops still in flight.
+    std::size_t approxSize() const{
+        return count.size();
+    }
+
+    ContainerStats stats() const{
+        return sink.snapshot();
+    }
+    
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _THREADSAFEVECTOR_H_
+#define _THREADSAFEVECTOR_H_
+
+#include <iostream>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+#include <utility>
+
+// Append-only vector for many writers. Storage is a ladder of segments, each
+// twice the size of the one before, so elements never move once written.
+// push_back claims an index with one fetch_add, allocates the segment if it is
+// the first there, constructs in place and then marks that one slot ready.
+// Reads and iteration take no lock; a slot claimed but not yet ready is
+// skipped by forEach and reported by ready(). Elements are never changed or
+// removed while the vector lives.
+template<typename T>
+class ThreadSafeVector{
+    // One allocation per segment: the elements, then one ready flag each, so
+    // the flags do not pad out the elements.
+    struct Segment{
+        T* items;
+        std::atomic<bool>* ready;
+
+        explicit Segment(const std::size_t n){
+            void* mem=::operator new(n*sizeof(T)+n*sizeof(std::atomic<bool>), std::align_val_t{alignof(T)});
+            items=static_cast<T*>(mem);
+            ready=reinterpret_cast<std::atomic<bool>*>(static_cast<unsigned char*>(mem)+n*sizeof(T));
+            for(std::size_t i=0; i<n; ++i) new (ready+i) std::atomic<bool>(false);
+        }
+
+        ~Segment(){
+            ::operator delete(static_cast<void*>(items), std::align_val_t{alignof(T)});
+        }
+    };
+
+    static constexpr unsigned int firstShift=4;
+    static constexpr unsigned int maxSegments=64-firstShift;
+
+    std::atomic<Segment*> segments[maxSegments];
+    std::atomic<std::size_t> next;
+
+    static std::size_t segmentSize(const unsigned int s){
+        return std::size_t{1}<<(s+firstShift);
+    }
+
+    // Index i lives in segment s at offset o, where i+2^firstShift = 2^(s+firstShift)+o.
+    static std::pair<unsigned int, std::size_t> locate(const std::size_t i){
+        const std::size_t p=i+(std::size_t{1}<<firstShift);
+        const unsigned int top=63-static_cast<unsigned int>(__builtin_clzll(p));
+        return {top-firstShift, p-(std::size_t{1}<<top)};
+    }
+
+    Segment* segment(const unsigned int s){
+        Segment* seg=segments[s].load(std::memory_order_acquire);
+        if(seg) return seg;
+        Segment* fresh=new Segment(segmentSize(s));
+        if(segments[s].compare_exchange_strong(seg, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) return fresh;
+        delete fresh;
+        return seg;
+    }
+
+    std::ostream& print(std::ostream& out) const{
+        forEach([&out](const T& t){
+            out << t << "  ";
+        });
+        out << "\n";
+        return out;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const ThreadSafeVector& tsv){
+        return tsv.print(out);
+    }
+
+public:
+    ThreadSafeVector(): next{0} {
+        for(auto& s : segments) s.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~ThreadSafeVector(){
+        for(unsigned int s=0; s<maxSegments; ++s){
+            Segment* seg=segments[s].load(std::memory_order_relaxed);
+            if(!seg) continue;
+            for(std::size_t o=0; o<segmentSize(s); ++o){
+                if(seg->ready[o].load(std::memory_order_relaxed)) seg->items[o].~T();
+            }
+            delete seg;
+        }
+    }
+
+    ThreadSafeVector(const ThreadSafeVector&)=delete;
+    ThreadSafeVector& operator=(const ThreadSafeVector&)=delete;
+
+    // Returns the index the value was stored at.
+    std::size_t push_back(T val){
+        const std::size_t i=next.fetch_add(1, std::memory_order_relaxed);
+        const auto at=locate(i);
+        Segment* seg=segment(at.first);
+        new (seg->items+at.second) T(std::move(val));
+        seg->ready[at.second].store(true, std::memory_order_release);
+        return i;
+    }
+
+    bool ready(const std::size_t i) const{
+        if(i>=next.load(std::memory_order_acquire)) return false;
+        const auto at=locate(i);
+        const Segment* seg=segments[at.first].load(std::memory_order_acquire);
+        return seg && seg->ready[at.second].load(std::memory_order_acquire);
+    }
+
+    // i must be ready(), or returned by a push_back that happened before.
+    const T& operator[](const std::size_t i) const{
+        const auto at=locate(i);
+        return segments[at.first].load(std::memory_order_acquire)->items[at.second];
+    }
+
+    // fn(const T&) on the ready elements in index order.
+    template<typename Func>
+    void forEach(Func fn) const{
+        std::size_t left=next.load(std::memory_order_acquire);
+        for(unsigned int s=0; left; ++s){
+            const Segment* seg=segments[s].load(std::memory_order_acquire);
+            const std::size_t n=std::min(left, segmentSize(s));
+            left-=n;
+            if(!seg) continue;
+            for(std::size_t o=0; o<n; ++o){
+                if(seg->ready[o].load(std::memory_order_acquire)) fn(seg->items[o]);
+            }
+        }
+    }
+
+    // Indices claimed so far, including appends still in flight.
+    std::size_t size() const{
+        return next.load(std::memory_order_acquire);
+    }
+};
+
+#endif